@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "util/crc32c.hxx"
+#include "util/timer.hxx"
+#include "util/tsc.hxx"
+
+using namespace dpx::trans;
+
+namespace {
+
+constexpr size_t total_bytes = 1uz << 30;
+constexpr size_t repeats = 5;
+
+struct Result {
+  double bytes_per_cycle;
+  double gb_per_s;
+};
+
+// best of `repeats` rounds, each hashing `total_bytes` in `len`-sized pieces
+Result run(Crc32cEngine engine, const std::vector<uint8_t>& data, size_t len) {
+  auto n_iters = std::max(total_bytes / len, 1uz);
+  if (engine == Crc32cEngine::Table) {
+    n_iters = std::max(n_iters / 16, 1uz);
+  }
+  Result best{0, 0};
+  uint32_t crc = 0;
+  for (auto r = 0uz; r < repeats; ++r) {
+    Timer timer;
+    auto begin = rdtsc();
+    for (auto i = 0uz; i < n_iters; ++i) {
+      crc = crc32c(engine, data.data(), len, crc);
+    }
+    auto cycles = rdtsc() - begin;
+    auto ns = timer.elapsed_ns().count();
+    auto bytes = static_cast<double>(n_iters * len);
+    best.bytes_per_cycle = std::max(best.bytes_per_cycle, bytes / cycles);
+    best.gb_per_s = std::max(best.gb_per_s, bytes / ns);
+  }
+  // keep the loop alive
+  asm volatile("" : : "r"(crc));
+  return best;
+}
+
+}  // namespace
+
+int main() {
+  constexpr std::array lens = {64uz, 512uz, 4096uz, 65536uz, 1uz << 20};
+  constexpr std::array engines = {Crc32cEngine::Table, Crc32cEngine::SliceBy8, Crc32cEngine::SSE42};
+
+  std::vector<uint8_t> data(lens.back());
+  std::mt19937 gen(42);
+  for (auto& b : data) {
+    b = gen();
+  }
+
+  std::cout << std::format("best engine: {}\n", crc32c_best_engine());
+  std::cout << std::format("{:>10} {:>10} {:>12} {:>10}\n", "engine", "len", "bytes/cycle", "GB/s");
+  for (auto engine : engines) {
+    if (!crc32c_engine_supported(engine)) {
+      std::cout << std::format("{:>10} unsupported\n", engine);
+      continue;
+    }
+    for (auto len : lens) {
+      auto r = run(engine, data, len);
+      std::cout << std::format("{:>10} {:>10} {:>12.3f} {:>10.3f}\n", engine, len, r.bytes_per_cycle, r.gb_per_s);
+    }
+  }
+  return 0;
+}
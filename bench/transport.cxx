@@ -0,0 +1,357 @@
+#include <args.hxx>
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <glaze/glaze.hpp>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "buffer_pool.hxx"
+#include "provider/shm/connector.hxx"
+#include "provider/shm/endpoint.hxx"
+#include "provider/tcp/connector.hxx"
+#include "provider/tcp/endpoint.hxx"
+#include "provider/tcp/uring_batcher.hxx"
+#include "rpc_desc.hxx"
+#include "rpc_transport.hxx"
+#include "runtime.hxx"
+#include "util/histogram.hxx"
+#include "util/logger.hxx"
+#include "util/timer.hxx"
+
+using namespace dpx::trans;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Payload {
+  std::string_view data;
+};
+
+// ping-pong, the response is as large as the request
+using Echo = RpcDesc<"BenchEcho", Payload, std::string>;
+// streaming, only a small ack goes back
+using Sink = RpcDesc<"BenchSink", Payload, uint64_t>;
+
+template <Backend b>
+using Endpoint = std::conditional_t<b == Backend::TCP, tcp::Endpoint, shm::Endpoint>;
+template <Backend b>
+using Server = RpcTransport<b, Side::ServerSide, Echo, Sink>;
+template <Backend b>
+using Client = RpcTransport<b, Side::ClientSide, Echo, Sink>;
+
+struct Config {
+  std::string ip;
+  uint16_t port;
+  std::string shm_name;
+  size_t n_io_threads;
+  size_t first_core;
+  std::chrono::milliseconds warmup;
+  std::chrono::milliseconds duration;
+};
+
+struct Case {
+  std::string workload;
+  size_t msg_size;
+  size_t depth;
+  size_t n_conns;
+  bool batching;
+};
+
+struct Latency {
+  double min_us;
+  double mean_us;
+  double p50_us;
+  double p99_us;
+  double p999_us;
+  double max_us;
+};
+
+struct Result {
+  Case c;
+  uint64_t n_ops;
+  double duration_s;
+  double ops_per_s;
+  double mb_per_s;
+  Latency latency;
+};
+
+struct Report {
+  std::string backend;
+  std::vector<Result> results;
+};
+
+template <Backend b>
+struct Connection {
+  Connection(Endpoint<b> se_, Endpoint<b> ce_, size_t max_payload_size, size_t depth)
+      : se(std::move(se_)),
+        ce(std::move(ce_)),
+        server(se, max_payload_size, depth),
+        client(ce, max_payload_size, depth) {}
+
+  Endpoint<b> se;
+  Endpoint<b> ce;
+  Server<b> server;
+  Client<b> client;
+  Histogram latency;
+  uint64_t n_ops = 0;
+  size_t n_callers = 0;
+};
+
+template <Backend b>
+std::vector<Endpoint<b>> accept(const Config& cfg, Runtime& rt, size_t n) {
+  if constexpr (b == Backend::TCP) {
+    return tcp::Connector<Side::ServerSide>(cfg.ip, cfg.port).accept(rt, n);
+  } else {
+    return shm::Connector<Side::ServerSide>(cfg.shm_name).accept(rt, n);
+  }
+}
+
+template <Backend b>
+std::vector<Endpoint<b>> connect(const Config& cfg, Runtime& rt, size_t n) {
+  // the server may not listen yet
+  for (auto attempt = 0;; ++attempt) {
+    try {
+      if constexpr (b == Backend::TCP) {
+        return tcp::Connector<Side::ClientSide>(cfg.ip, cfg.port, cfg.ip, 0).connect(rt, n);
+      } else {
+        return shm::Connector<Side::ClientSide>(cfg.shm_name).connect(rt, n);
+      }
+    } catch (const std::system_error&) {
+      if (attempt == 100) {
+        throw;
+      }
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+}
+
+template <Backend b>
+Result run_case(const Config& cfg, const Case& c) {
+  Runtime server_rt(cfg.n_io_threads, 0, cfg.first_core);
+  Runtime client_rt(cfg.n_io_threads, 0, cfg.first_core + cfg.n_io_threads);
+
+  // one batcher per io thread and side, the i-th endpoint runs on the (i % n_io_threads)-th io thread.
+  // Frames come from the default pool, so receives land in registered buffers.
+  std::vector<std::pair<asio::io_context*, std::unique_ptr<tcp::UringBatcher>>> batchers;
+  if (c.batching) {
+    for (auto i = 0uz; i < cfg.n_io_threads; ++i) {
+      batchers.emplace_back(&server_rt.io(i), std::make_unique<tcp::UringBatcher>(server_rt.io(i)));
+      batchers.emplace_back(&client_rt.io(i), std::make_unique<tcp::UringBatcher>(client_rt.io(i)));
+    }
+    for (auto& [_, batcher] : batchers) {
+      batcher->register_pool(BufferPool::instance());
+    }
+  }
+
+  auto accepted = std::async(std::launch::async, [&]() { return accept<b>(cfg, server_rt, c.n_conns); });
+  auto ces = connect<b>(cfg, client_rt, c.n_conns);
+  auto ses = accepted.get();
+
+  std::vector<std::unique_ptr<Connection<b>>> conns;
+  for (auto i = 0uz; i < c.n_conns; ++i) {
+    if constexpr (b == Backend::TCP) {
+      if (c.batching) {
+        ses[i].set_batcher(batchers[2 * (i % cfg.n_io_threads)].second.get());
+        ces[i].set_batcher(batchers[2 * (i % cfg.n_io_threads) + 1].second.get());
+      }
+    }
+    conns.emplace_back(std::make_unique<Connection<b>>(std::move(ses[i]), std::move(ces[i]), c.msg_size + 64, c.depth));
+    conns.back()->server.template register_handler<Echo>([](Payload& req) { return std::string(req.data); });
+    conns.back()->server.template register_handler<Sink>([](Payload& req) -> uint64_t { return req.data.size(); });
+  }
+
+  const std::string msg(c.msg_size, 'x');
+  const bool ping_pong = c.workload == "latency";
+  std::atomic_bool measuring = false;
+  std::atomic_bool stopping = false;
+  auto caller = [&](Connection<b>& conn) -> asio::awaitable<void> {
+    while (!stopping.load(std::memory_order_relaxed)) {
+      Timer timer;
+      if (ping_pong) {
+        co_await conn.client.template call<Echo>(Payload{msg});
+      } else {
+        co_await conn.client.template call<Sink>(Payload{msg});
+      }
+      if (measuring.load(std::memory_order_relaxed) && !stopping.load(std::memory_order_relaxed)) {
+        conn.latency.record(timer.elapsed_ns().count());
+        conn.n_ops++;
+      }
+    }
+    if (--conn.n_callers == 0) {
+      conn.ce.close();
+    }
+  };
+
+  auto log_error = [](std::exception_ptr e) {
+    if (e) {
+      try {
+        std::rethrow_exception(e);
+      } catch (const std::exception& err) {
+        LOG_ERROR("Benchmark coroutine fails: {}", err.what());
+      }
+    }
+  };
+  std::latch conns_done(2 * c.n_conns);
+  std::latch batchers_done(batchers.size());
+  for (auto& [io, b] : batchers) {
+    asio::co_spawn(*io, b->run(), [&](std::exception_ptr e) {
+      log_error(e);
+      batchers_done.count_down();
+    });
+  }
+  auto on_conn_done = [&](std::exception_ptr e) {
+    log_error(e);
+    conns_done.count_down();
+  };
+  for (auto& conn : conns) {
+    asio::co_spawn(conn->se.get_executor(), conn->server.serve(), on_conn_done);
+    asio::co_spawn(conn->ce.get_executor(), conn->client.run(), on_conn_done);
+    conn->n_callers = c.depth;
+    for (auto i = 0uz; i < c.depth; ++i) {
+      asio::co_spawn(conn->ce.get_executor(), caller(*conn), log_error);
+    }
+  }
+
+  server_rt.start();
+  client_rt.start();
+  std::this_thread::sleep_for(cfg.warmup);
+  measuring = true;
+  Timer timer;
+  std::this_thread::sleep_for(cfg.duration);
+  stopping = true;
+  auto elapsed = timer.elapsed_ns();
+
+  conns_done.wait();
+  for (auto& [io, b] : batchers) {
+    asio::post(*io, [b = b.get()]() { b->stop(); });
+  }
+  batchers_done.wait();
+  server_rt.stop();
+  client_rt.stop();
+  server_rt.join();
+  client_rt.join();
+
+  Histogram latency;
+  uint64_t n_ops = 0;
+  for (auto& conn : conns) {
+    latency.merge(conn->latency);
+    n_ops += conn->n_ops;
+  }
+  auto duration_s = std::chrono::duration<double>(elapsed).count();
+  auto us = [](uint64_t ns) { return ns / 1e3; };
+  return Result{
+      .c = c,
+      .n_ops = n_ops,
+      .duration_s = duration_s,
+      .ops_per_s = n_ops / duration_s,
+      .mb_per_s = n_ops * c.msg_size / duration_s / 1e6,
+      .latency =
+          Latency{
+              .min_us = us(latency.min()),
+              .mean_us = latency.mean() / 1e3,
+              .p50_us = us(latency.percentile(50)),
+              .p99_us = us(latency.percentile(99)),
+              .p999_us = us(latency.percentile(99.9)),
+              .max_us = us(latency.max()),
+          },
+  };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  args::ArgumentParser parser(
+      "Transport benchmark over loopback tcp or shared memory: ping-pong latency and streaming throughput");
+  args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+  args::ValueFlag<std::string> backend(parser, "tcp|shm", "Transport backend", {"backend"}, "tcp");
+  args::ValueFlag<std::string> ip(parser, "ip", "Address of both sides", {"ip"}, "127.0.0.1");
+  args::ValueFlag<uint16_t> port(parser, "port", "Port of the server side", {"port"}, 10087);
+  args::ValueFlag<std::string> shm_name(parser, "name", "Name of the shm segments", {"shm-name"}, "dpx-trans-bench");
+  args::ValueFlagList<std::string> workloads(parser, "workload", "latency and/or throughput", {'w', "workload"},
+                                             {"latency", "throughput"});
+  args::ValueFlagList<size_t> sizes(parser, "bytes", "Message sizes", {'s', "size"}, {64, 4096, 65536});
+  args::ValueFlagList<size_t> depths(parser, "n", "Outstanding calls per connection", {'q', "depth"}, {1, 16});
+  args::ValueFlagList<size_t> n_conns(parser, "n", "Connection counts", {'c', "conns"}, {1, 4});
+  args::ValueFlagList<int> batchings(parser, "0|1", "Without and/or with io_uring batching of tcp",
+                                     {'b', "batching"}, {0, 1});
+  args::ValueFlag<size_t> n_io_threads(parser, "n", "io threads per side", {"io-threads"}, 1);
+  args::ValueFlag<size_t> first_core(parser, "core", "First core to pin io threads to", {"first-core"}, 0);
+  args::ValueFlag<size_t> warmup_ms(parser, "ms", "Warmup of each case", {"warmup"}, 200);
+  args::ValueFlag<size_t> duration_ms(parser, "ms", "Duration of each case", {'d', "duration"}, 1000);
+  args::ValueFlag<std::string> output(parser, "path", "Write the json report to a file instead of stdout",
+                                      {'o', "output"});
+  try {
+    parser.ParseCLI(argc, argv);
+  } catch (const args::Help&) {
+    std::cout << parser;
+    return 0;
+  } catch (const args::Error& e) {
+    std::cerr << e.what() << std::endl << parser;
+    return 1;
+  }
+
+  Config cfg{
+      .ip = args::get(ip),
+      .port = args::get(port),
+      .shm_name = args::get(shm_name),
+      .n_io_threads = args::get(n_io_threads),
+      .first_core = args::get(first_core),
+      .warmup = std::chrono::milliseconds(args::get(warmup_ms)),
+      .duration = std::chrono::milliseconds(args::get(duration_ms)),
+  };
+  if (args::get(backend) != "tcp" && args::get(backend) != "shm") {
+    std::cerr << "Unknown backend: " << args::get(backend) << std::endl;
+    return 1;
+  }
+  const bool shm = args::get(backend) == "shm";
+  // batching applies to tcp only, and needs io_uring
+  const bool uring = !shm && tcp::UringBatcher::supported();
+  if (!shm && !uring) {
+    LOG_WARN("io_uring is unavailable, cases with batching are skipped");
+  }
+  Report report{.backend = args::get(backend), .results = {}};
+  for (const auto& w : args::get(workloads)) {
+    if (w != "latency" && w != "throughput") {
+      std::cerr << "Unknown workload: " << w << std::endl;
+      return 1;
+    }
+    for (auto batching : args::get(batchings)) {
+      if (batching != 0 && !uring) {
+        continue;
+      }
+      for (auto n : args::get(n_conns)) {
+        for (auto depth : args::get(depths)) {
+          for (auto size : args::get(sizes)) {
+            Case c{.workload = w, .msg_size = size, .depth = depth, .n_conns = n, .batching = batching != 0};
+            auto r = shm ? run_case<Backend::SHM>(cfg, c) : run_case<Backend::TCP>(cfg, c);
+            LOG_INFO("{} size={} depth={} conns={} batching={}: {:.0f} ops/s, {:.1f} MB/s, p50 {:.1f}us, p99 {:.1f}us",
+                     w, size, depth, n, c.batching, r.ops_per_s, r.mb_per_s, r.latency.p50_us,
+                     r.latency.p99_us);
+            report.results.emplace_back(std::move(r));
+          }
+        }
+      }
+    }
+  }
+
+  std::string json;
+  if (auto ec = glz::write<glz::opts{.prettify = true}>(report, json); ec) {
+    std::cerr << "Fail to write json report: " << glz::format_error(ec, json) << std::endl;
+    return 1;
+  }
+  if (output) {
+    std::ofstream(args::get(output)) << json << std::endl;
+  } else {
+    std::cout << json << std::endl;
+  }
+  return 0;
+}
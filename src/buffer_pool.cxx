@@ -0,0 +1,248 @@
+#include "buffer_pool.hxx"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/thread_util.hxx"
+#include "util/upper_align.hxx"
+
+namespace dpx::trans {
+
+namespace {
+
+constexpr size_t hugepage_size = 2 * 1024 * 1024;
+constexpr size_t page_size = 4096;
+
+}  // namespace
+
+size_t Buffer::capacity() const { return pool == nullptr ? 0 : BufferPool::class_size(size_class); }
+
+void Buffer::resize(size_t len_) {
+  if (auto cap = capacity(); len_ > cap) {
+    die("Fail to resize {} to {}, capacity: {}", static_cast<MemoryRegion&>(*this), len_, cap);
+  }
+  len = len_;
+}
+
+void Buffer::release() {
+  if (pool != nullptr) {
+    if (on_heap) {
+      pool->release_to_heap(raw_data());
+    } else {
+      assert(pool->owns(*this));
+      pool->release(raw_data(), size_class);
+    }
+    reset();
+  }
+}
+
+BufferPool::BufferPool(size_t chunk_size_, bool use_hugepage_, size_t batch_size_, size_t max_buffers_per_class_)
+    : chunk_size(upper_align(chunk_size_, use_hugepage_ ? hugepage_size : page_size)),
+      use_hugepage(use_hugepage_),
+      batch_size(batch_size_),
+      max_buffers_per_class(max_buffers_per_class_) {
+  if (batch_size == 0 || batch_size > max_buffers_per_class) {
+    die("Invalid batch size {}, max buffers per class: {}", batch_size, max_buffers_per_class);
+  }
+  for (auto& free_list : global_free_lists) {
+    free_list = std::make_unique<rigtorp::MPMCQueue<void*>>(max_buffers_per_class);
+  }
+  // the next thread taking the index starts with an empty cache
+  exit_hook = add_thread_exit_hook([this](size_t idx) { flush_cache(idx); });
+}
+
+BufferPool::~BufferPool() {
+  remove_thread_exit_hook(exit_hook);
+  for (auto i = 0uz; i < n_classes; ++i) {
+    auto n_free = static_cast<size_t>(global_free_lists[i]->size());
+    for (auto& cache : caches) {
+      if (cache != nullptr) {
+        n_free += cache->free_lists[i].size();
+      }
+    }
+    if (auto n = n_carved[i]; n_free != n) {
+      LOG_WARN("{} buffers of {} bytes are not returned to the pool", n - n_free, class_size(i));
+    }
+  }
+  if (auto n = n_heap_buffers.load(); n != 0) {
+    LOG_WARN("{} buffers allocated from the heap are not returned to the pool", n);
+  }
+  for (auto& chunk : chunk_list) {
+    munmap(chunk.raw_data(), chunk.size());
+  }
+}
+
+Buffer BufferPool::acquire(size_t len) {
+  auto size_class = size_class_of(len);
+  if (size_class >= n_classes) {
+    auto max_size = class_size(n_classes - 1);
+    die("Buffer of {} bytes exceeds max size class {}", len, max_size);
+  }
+  auto& free_list = local_cache().free_lists[size_class];
+  if (free_list.empty()) {
+    refill(free_list, size_class);
+  }
+  if (free_list.empty()) [[unlikely]] {
+    return acquire_from_heap(len, size_class);
+  }
+  auto p = free_list.back();
+  free_list.pop_back();
+  return Buffer(this, p, len, size_class);
+}
+
+bool BufferPool::owns(const MemoryRegion& mr) const {
+  std::lock_guard l(chunk_lock);
+  return std::any_of(chunk_list.begin(), chunk_list.end(), [&](const auto& chunk) { return chunk.contain(mr); });
+}
+
+std::vector<MemoryRegion> BufferPool::chunks() const {
+  std::lock_guard l(chunk_lock);
+  return chunk_list;
+}
+
+size_t BufferPool::add_chunk_listener(std::function<void(const MemoryRegion&)> listener) {
+  std::lock_guard l(chunk_lock);
+  auto id = next_listener_id++;
+  chunk_listeners.emplace_back(id, std::move(listener));
+  return id;
+}
+
+void BufferPool::remove_chunk_listener(size_t id) {
+  std::lock_guard l(chunk_lock);
+  std::erase_if(chunk_listeners, [id](const auto& listener) { return listener.first == id; });
+}
+
+void BufferPool::flush_local_cache() { flush_cache(thread_index()); }
+
+void BufferPool::flush_cache(size_t thread_idx) {
+  if (thread_idx >= max_threads || caches[thread_idx] == nullptr) {
+    return;
+  }
+  auto& cache = *caches[thread_idx];
+  for (auto i = 0u; i < n_classes; ++i) {
+    flush(cache.free_lists[i], i, 0);
+  }
+}
+
+BufferPool& BufferPool::instance() {
+  static BufferPool pool;
+  return pool;
+}
+
+BufferPool::LocalCache& BufferPool::local_cache() {
+  auto idx = thread_index();
+  if (idx >= max_threads) {
+    die("Thread index {} exceeds max threads {} of buffer pool, too many threads are alive", idx, max_threads);
+  }
+  auto& cache = caches[idx];
+  if (cache == nullptr) [[unlikely]] {
+    cache = std::make_unique<LocalCache>();
+    for (auto& free_list : cache->free_lists) {
+      free_list.reserve(2 * batch_size);
+    }
+  }
+  return *cache;
+}
+
+void BufferPool::release(void* p, uint32_t size_class) {
+  auto& free_list = local_cache().free_lists[size_class];
+  free_list.push_back(p);
+  if (free_list.size() >= 2 * batch_size) {
+    flush(free_list, size_class, batch_size);
+  }
+}
+
+Buffer BufferPool::acquire_from_heap(size_t len, uint32_t size_class) {
+  auto size = class_size(size_class);
+  auto p = std::aligned_alloc(std::min(size, page_size), size);
+  if (p == nullptr) {
+    die("Fail to allocate buffer of {} bytes from heap", size);
+  }
+  n_heap_buffers.fetch_add(1, std::memory_order_relaxed);
+  return Buffer(this, p, len, size_class, true);
+}
+
+void BufferPool::release_to_heap(void* p) {
+  std::free(p);
+  n_heap_buffers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void BufferPool::refill(std::vector<void*>& free_list, uint32_t size_class) {
+  auto& global = *global_free_lists[size_class];
+  void* p = nullptr;
+  while (free_list.size() < batch_size && global.try_pop(p)) {
+    free_list.push_back(p);
+  }
+  if (free_list.empty()) {
+    carve(free_list, size_class);
+  }
+}
+
+void BufferPool::flush(std::vector<void*>& free_list, uint32_t size_class, size_t keep) {
+  auto& global = *global_free_lists[size_class];
+  while (free_list.size() > keep) {
+    // never fails, the global free list can hold all buffers of this size class
+    if (!global.try_push(free_list.back())) {
+      die("Global free list of size class {} is full", size_class);
+    }
+    free_list.pop_back();
+  }
+}
+
+void BufferPool::carve(std::vector<void*>& free_list, uint32_t size_class) {
+  auto size = class_size(size_class);
+  auto align = std::min(size, page_size);
+
+  std::lock_guard l(chunk_lock);
+  // at most one chunk's worth of bytes per refill, buffers of large classes are carved one at a time
+  auto n = std::min({batch_size, max_buffers_per_class - n_carved[size_class], std::max(chunk_size / size, 1uz)});
+  if (n == 0) {
+    if (!std::exchange(exhausted[size_class], true)) {
+      LOG_WARN("Buffer pool is exhausted, size class: {}, max buffers: {}, fallback to heap", size,
+               max_buffers_per_class);
+    }
+    return;
+  }
+  n_carved[size_class] += n;
+  for (auto i = 0uz; i < n; ++i) {
+    auto offset = upper_align(current_used, align);
+    if (current_chunk.empty() || offset + size > current_chunk.size()) {
+      current_chunk = allocate_chunk(std::max(size, chunk_size));
+      chunk_list.push_back(current_chunk);
+      for (auto& [_, listener] : chunk_listeners) {
+        listener(current_chunk);
+      }
+      offset = 0;
+    }
+    free_list.push_back(current_chunk.sub_region(offset, size).raw_data());
+    current_used = offset + size;
+  }
+}
+
+MemoryRegion BufferPool::allocate_chunk(size_t size) {
+  size = upper_align(size, use_hugepage ? hugepage_size : page_size);
+  void* p = MAP_FAILED;
+  if (use_hugepage) {
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+      LOG_WARN("Fail to allocate {} bytes from hugetlb, errno: {}, fallback to transparent hugepage", size, errno);
+    }
+  }
+  if (p == MAP_FAILED) {
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      die("Fail to allocate chunk of {} bytes, errno: {}", size, errno);
+    }
+    if (use_hugepage) {
+      madvise(p, size, MADV_HUGEPAGE);
+    }
+  }
+  return MemoryRegion(p, size);
+}
+
+}  // namespace dpx::trans
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <rigtorp/MPMCQueue.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "memory_region.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/spin_lock.hxx"
+
+namespace dpx::trans {
+
+class BufferPool;
+
+// An owning handle of a pooled buffer, which returns the buffer to its pool on destruction.
+// size() is the requested length, capacity() is the length of the size class.
+class Buffer : public MemoryRegion, Noncopyable {
+  friend class BufferPool;
+
+  Buffer(BufferPool* pool_, void* base_, size_t len_, uint32_t size_class_, bool on_heap_ = false)
+      : MemoryRegion(base_, len_), pool(pool_), size_class(size_class_), on_heap(on_heap_) {}
+
+ public:
+  Buffer() = default;
+  ~Buffer() { release(); }
+
+  Buffer(Buffer&& other) noexcept
+      : MemoryRegion(other), pool(other.pool), size_class(other.size_class), on_heap(other.on_heap) {
+    other.reset();
+  }
+  Buffer& operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+      release();
+      static_cast<MemoryRegion&>(*this) = other;
+      pool = other.pool;
+      size_class = other.size_class;
+      on_heap = other.on_heap;
+      other.reset();
+    }
+    return *this;
+  }
+
+  size_t capacity() const;
+
+  // shrink or grow the visible length within the capacity
+  void resize(size_t len_);
+
+  void release();
+
+ private:
+  void reset() {
+    base = 0;
+    len = 0;
+    pool = nullptr;
+  }
+
+  BufferPool* pool = nullptr;
+  uint32_t size_class = 0;
+  bool on_heap = false;  // allocated past the limit of its size class
+};
+
+// A pool of buffers in power-of-two size classes.
+// Each thread keeps a small cache per size class, which is refilled from and flushed to a lock-free global free
+// list in batches. Buffers are carved from large chunks, which is the unit to register for the future RDMA backends.
+// Once a size class has carved max_buffers_per_class buffers, further ones are allocated from the heap and freed on
+// release. They lie outside the chunks, so they are never registered.
+// The pool must outlive all the buffers acquired from it.
+class BufferPool : Noncopyable, Nonmovable {
+  friend class Buffer;
+
+ public:
+  constexpr static size_t min_class_shift = 6;   // 64 B
+  constexpr static size_t max_class_shift = 24;  // 16 MiB
+  constexpr static size_t n_classes = max_class_shift - min_class_shift + 1;
+  constexpr static size_t max_threads = 256;  // alive at the same time
+
+  constexpr static size_t default_chunk_size = 2 * 1024 * 1024;
+  constexpr static size_t default_batch_size = 32;
+  constexpr static size_t default_max_buffers_per_class = 1024;
+
+  explicit BufferPool(size_t chunk_size_ = default_chunk_size, bool use_hugepage_ = false,
+                      size_t batch_size_ = default_batch_size,
+                      size_t max_buffers_per_class_ = default_max_buffers_per_class);
+  ~BufferPool();
+
+  Buffer acquire(size_t len);
+
+  // whether the region lies in one of the chunks of this pool
+  bool owns(const MemoryRegion& mr) const;
+
+  std::vector<MemoryRegion> chunks() const;
+
+  // `listener` is told about every chunk mapped from now on. It runs on the thread that maps the chunk, under the chunk
+  // lock, so it must not call back into the pool. Returns an id for remove_chunk_listener.
+  size_t add_chunk_listener(std::function<void(const MemoryRegion&)> listener);
+  void remove_chunk_listener(size_t id);
+
+  // return all buffers cached by the calling thread, the caches of exiting threads are flushed automatically
+  void flush_local_cache();
+
+  static BufferPool& instance();
+
+  static constexpr uint32_t size_class_of(size_t len) {
+    auto shift = std::max<size_t>(std::bit_width(std::max<size_t>(len, 1) - 1), min_class_shift);
+    return static_cast<uint32_t>(shift - min_class_shift);
+  }
+
+  static constexpr size_t class_size(uint32_t size_class) { return 1uz << (size_class + min_class_shift); }
+
+ private:
+  struct LocalCache {
+    std::array<std::vector<void*>, n_classes> free_lists;
+  };
+
+  LocalCache& local_cache();
+  void flush_cache(size_t thread_idx);
+  void release(void* p, uint32_t size_class);
+  Buffer acquire_from_heap(size_t len, uint32_t size_class);
+  void release_to_heap(void* p);
+  void refill(std::vector<void*>& free_list, uint32_t size_class);
+  void flush(std::vector<void*>& free_list, uint32_t size_class, size_t keep);
+  void carve(std::vector<void*>& free_list, uint32_t size_class);
+  MemoryRegion allocate_chunk(size_t size);
+
+  const size_t chunk_size;
+  const bool use_hugepage;
+  const size_t batch_size;
+  const size_t max_buffers_per_class;
+
+  std::array<std::unique_ptr<LocalCache>, max_threads> caches;  // by thread index
+  size_t exit_hook = 0;
+  std::array<std::unique_ptr<rigtorp::MPMCQueue<void*>>, n_classes> global_free_lists;
+
+  mutable SpinLock chunk_lock;
+  std::array<size_t, n_classes> n_carved{};   // guarded by chunk_lock
+  std::array<bool, n_classes> exhausted{};    // guarded by chunk_lock
+  std::atomic<size_t> n_heap_buffers = 0;     // not yet released
+  std::vector<MemoryRegion> chunk_list;
+  std::vector<std::pair<size_t, std::function<void(const MemoryRegion&)>>> chunk_listeners;
+  size_t next_listener_id = 0;
+  MemoryRegion current_chunk;
+  size_t current_used = 0;
+};
+
+}  // namespace dpx::trans
@@ -12,6 +12,7 @@ enum class Backend : uint32_t {
   Verbs,
   DOCA_Comch,
   DOCA_RDMA,
+  SHM,
 };
 
 enum class Side : uint32_t {
@@ -33,6 +34,6 @@ enum class ErrorCode : ssize_t {
 
 }  // namespace dpx::trans
 
-EnumFormatter(4, dpx::trans::Backend, TCP, Verbs, DOCA_Comch, DOCA_RDMA);
+EnumFormatter(5, dpx::trans::Backend, TCP, Verbs, DOCA_Comch, DOCA_RDMA, SHM);
 EnumFormatter(2, dpx::trans::Side, ServerSide, ClientSide);
 EnumFormatter(4, dpx::trans::Op, Send, Recv, Read, Write);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "def.hxx"
+#include "provider/shm/endpoint.hxx"
+#include "provider/shm/segment.hxx"
+#include "runtime.hxx"
+#include "util/fatal.hxx"
+#include "util/futex.hxx"
+
+namespace dpx::trans::shm {
+
+// Rendezvous of co-located processes by name: the server side creates one segment per endpoint, "/<name>.<i>", and
+// waits for the client side to attach to each of them. Names are unlinked once both sides have mapped the segment.
+template <Side side>
+class Connector {
+ public:
+  constexpr static size_t default_ring_capacity = 1uz << 20;
+
+  // passive
+  explicit Connector(std::string name_, size_t ring_capacity_ = default_ring_capacity)
+    requires(side == Side::ServerSide)
+      : name(std::move(name_)), ring_capacity(ring_capacity_) {}
+  // active
+  explicit Connector(std::string name_)
+    requires(side == Side::ClientSide)
+      : name(std::move(name_)) {}
+
+  ~Connector() = default;
+
+  std::vector<Endpoint> accept(asio::io_context& io, size_t n)
+    requires(side == Side::ServerSide)
+  {
+    return do_accept([&](size_t) -> asio::io_context& { return io; }, n);
+  }
+
+  // the i-th endpoint is owned by the (i % rt.size())-th io thread of the runtime
+  std::vector<Endpoint> accept(Runtime& rt, size_t n)
+    requires(side == Side::ServerSide)
+  {
+    return do_accept([&](size_t i) -> asio::io_context& { return rt.io(i); }, n);
+  }
+
+  // throws std::system_error with connection_refused if the server side is not listening yet
+  std::vector<Endpoint> connect(asio::io_context& io, size_t n)
+    requires(side == Side::ClientSide)
+  {
+    return do_connect([&](size_t) -> asio::io_context& { return io; }, n);
+  }
+
+  // the i-th endpoint is owned by the (i % rt.size())-th io thread of the runtime
+  std::vector<Endpoint> connect(Runtime& rt, size_t n)
+    requires(side == Side::ClientSide)
+  {
+    return do_connect([&](size_t i) -> asio::io_context& { return rt.io(i); }, n);
+  }
+
+ private:
+  std::string segment_name(size_t i) const { return std::format("/{}.{}", name, i); }
+
+  template <typename IoOf>
+  std::vector<Endpoint> do_accept(IoOf&& io_of, size_t n) {
+    std::vector<Segment> segments;
+    for (auto i = 0uz; i < n; i++) {
+      segments.emplace_back(Segment::create(segment_name(i), ring_capacity));
+    }
+    // clients attach in order, once the first segment listens all of them do
+    for (auto i = n; i-- > 0;) {
+      segments[i].header().state.store(SegmentHeader::Listening, std::memory_order_release);
+    }
+    std::vector<Endpoint> conns;
+    for (auto i = 0uz; i < n; i++) {
+      auto& state = segments[i].header().state;
+      while (state.load(std::memory_order_acquire) != SegmentHeader::Connected) {
+        futex_wait(state, SegmentHeader::Listening, std::chrono::milliseconds(100));
+      }
+      Segment::unlink(segments[i].name());
+      conns.emplace_back(io_of(i), std::move(segments[i]), Side::ServerSide);
+    }
+    return conns;
+  }
+
+  template <typename IoOf>
+  std::vector<Endpoint> do_connect(IoOf&& io_of, size_t n) {
+    std::vector<Endpoint> conns;
+    for (auto i = 0uz; i < n; i++) {
+      auto segment = Segment::open(segment_name(i));
+      auto& state = segment.header().state;
+      auto expected = static_cast<uint32_t>(SegmentHeader::Listening);
+      if (!state.compare_exchange_strong(expected, SegmentHeader::Connected)) {
+        auto name = segment.name();
+        die("Shm segment {} is already connected", name);
+      }
+      futex_wake(state);
+      conns.emplace_back(io_of(i), std::move(segment), Side::ClientSide);
+    }
+    return conns;
+  }
+
+  std::string name;
+  size_t ring_capacity = default_ring_capacity;
+};
+
+}  // namespace dpx::trans::shm
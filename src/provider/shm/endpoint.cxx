@@ -0,0 +1,42 @@
+#include "provider/shm/endpoint.hxx"
+
+#include <format>
+#include <thread>
+
+namespace dpx::trans::shm {
+
+Endpoint::State::State(asio::io_context& io_, Segment segment_, Side side_)
+    : io(io_),
+      waiter(asio::use_service<Waiter>(io_)),
+      segment(std::move(segment_)),
+      side(side_),
+      peer_side(side_ == Side::ClientSide ? Side::ServerSide : Side::ClientSide),
+      tx(segment.header().rings[SegmentHeader::idx(side)], segment.ring_data(side)),
+      rx(segment.header().rings[SegmentHeader::idx(peer_side)], segment.ring_data(peer_side)),
+      // with a single core the peer cannot make progress while we spin
+      spin_rounds(std::thread::hardware_concurrency() > 1 ? default_spin_rounds : 0),
+      stats(std::format("shm {} {}", segment.name(), side)) {}
+
+Endpoint::State::~State() { close(); }
+
+void Endpoint::State::close() {
+  if (closing) {
+    return;
+  }
+  closing = true;
+  segment.header().closed[SegmentHeader::idx(side)].store(1);
+  ring(peer());
+  // resumes our own parked operations, which then abort
+  ring(own(), true);
+}
+
+void Endpoint::State::ring(Doorbell& bell, bool force) {
+  // pairs with the parked count being raised before the parker rechecks the rings
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (force || bell.n_parked.load(std::memory_order_relaxed) > 0) {
+    bell.seq.fetch_add(1, std::memory_order_release);
+    futex_wake(bell.seq);
+  }
+}
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <asio.hpp>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+
+#include "def.hxx"
+#include "memory_region.hxx"
+#include "provider/shm/ring.hxx"
+#include "provider/shm/segment.hxx"
+#include "provider/shm/waiter.hxx"
+#include "stats.hxx"
+#include "util/fatal.hxx"
+#include "util/futex.hxx"
+#include "util/logger.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/unreachable.hxx"
+
+namespace dpx::trans::shm {
+
+// One side of a connected segment, a byte stream like tcp::Endpoint: writes complete when all bytes are in the ring,
+// reads when all requested bytes are out of it.
+// An operation that cannot make progress yields to its io_context up to `spin_rounds` times, polling the ring in
+// between, then parks on the doorbell of its side. Parked operations are resumed by the Waiter of the io_context once
+// the peer rings the doorbell, so an idle endpoint costs no cpu and does not block its io thread. Spinning only pays
+// off when both sides have cores of their own.
+// All operations must come from the thread running the io_context.
+class Endpoint : Noncopyable {
+  struct State : Noncopyable, Nonmovable {
+    State(asio::io_context& io_, Segment segment_, Side side_);
+    ~State();
+
+    Doorbell& own() { return segment.header().doorbells[SegmentHeader::idx(side)]; }
+    Doorbell& peer() { return segment.header().doorbells[SegmentHeader::idx(peer_side)]; }
+    bool closed_by_peer() { return segment.header().closed[SegmentHeader::idx(peer_side)].load(); }
+
+    void close();
+    void ring(Doorbell& bell, bool force = false);
+
+    asio::io_context& io;
+    Waiter& waiter;
+    Segment segment;
+    Side side;
+    Side peer_side;
+    Ring tx;
+    Ring rx;
+    bool closing = false;
+    size_t spin_rounds;
+    EndpointStats stats;
+  };
+
+ public:
+  // max number of regions in one scatter-gather post
+  constexpr static size_t max_iov = 16;
+  // polls without progress before parking
+  constexpr static size_t default_spin_rounds = 256;
+
+  Endpoint(asio::io_context& io, Segment segment, Side side)
+      : s(std::make_shared<State>(io, std::move(segment), side)) {}
+
+  // suspended operations are aborted, they keep the state until they return
+  ~Endpoint() {
+    if (s != nullptr) {
+      s->close();
+    }
+  }
+
+  Endpoint(Endpoint&& other) noexcept : s(std::move(other.s)) {}
+  Endpoint& operator=(Endpoint&& other) noexcept {
+    if (this != &other) {
+      if (s != nullptr) {
+        s->close();
+      }
+      s = std::move(other.s);
+    }
+    return *this;
+  }
+
+  asio::any_io_executor get_executor() { return s->io.get_executor(); }
+
+  // e.g. "shm /dpx.0 ClientSide"
+  const std::string& name() const { return s->stats.name; }
+
+  // pending operations are aborted, the peer reads eof once it has drained the ring
+  void close() { s->close(); }
+
+  // 0 parks as soon as the ring is empty or full
+  void set_spin_rounds(size_t n) { s->spin_rounds = n; }
+
+  template <Op op>
+  asio::awaitable<size_t> post(MemoryRegion& mr) {
+    return post<op>(std::span(&mr, 1));
+  }
+
+  // gathered write or scattered read of all regions in one operation
+  template <Op op>
+  asio::awaitable<size_t> post(std::span<MemoryRegion> mrs) {
+    constexpr bool is_write = (op == Op::Send || op == Op::Write);
+    constexpr bool is_read = (op == Op::Recv || op == Op::Read);
+    static_assert(is_write || is_read);
+    LOG_DEBUG("shm post {} {} regions", op, mrs.size());
+    if (mrs.size() > max_iov) {
+      auto n = mrs.size();
+      die("Too many regions: {}, max: {}", n, max_iov);
+    }
+    // the endpoint may be destroyed while the operation is suspended, the state lives on until it returns
+    auto st = s;
+    OpProbe probe(st->stats.of<op>());
+    auto n = 0uz;
+    auto idle = 0uz;
+    for (auto& mr : mrs) {
+      for (auto off = 0uz; off < mr.size();) {
+        if (st->closing) {
+          // the end of a connection is not an error
+          probe.cancel();
+          throw std::system_error(asio::error_code(asio::error::operation_aborted));
+        }
+        auto k = 0uz;
+        if constexpr (is_write) {
+          k = st->tx.write(mr.data() + off, mr.size() - off);
+        } else {
+          k = st->rx.read(mr.data() + off, mr.size() - off);
+        }
+        if (k > 0) {
+          off += k;
+          n += k;
+          idle = 0;
+          st->ring(st->peer());
+          continue;
+        }
+        if constexpr (is_write) {
+          if (st->closed_by_peer()) {
+            throw std::system_error(asio::error_code(asio::error::broken_pipe));
+          }
+        } else {
+          // data written before the peer closed is still delivered
+          if (st->closed_by_peer() && !st->rx.readable()) {
+            probe.cancel();
+            throw std::system_error(asio::error_code(asio::error::eof));
+          }
+        }
+        if (++idle <= st->spin_rounds) {
+          co_await asio::post(st->io, asio::use_awaitable);
+        } else {
+          co_await park<op>(*st);
+        }
+      }
+    }
+    probe.done(n);
+    co_return n;
+  }
+
+ private:
+  template <Op op>
+  static asio::awaitable<void> park(State& st) {
+    auto& bell = st.own();
+    bell.n_parked.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto seq = bell.seq.load();
+    // either the peer sees us parked, or we see its progress here
+    bool ready = false;
+    if constexpr (op == Op::Send || op == Op::Write) {
+      ready = st.tx.writable();
+    } else {
+      ready = st.rx.readable();
+    }
+    if (!ready && !st.closed_by_peer() && !st.closing) {
+      co_await asio::async_initiate<const asio::use_awaitable_t<>, void()>(
+          [&st, seq](auto handler) { st.waiter.park(st.own().seq, seq, std::move(handler)); }, asio::use_awaitable);
+    }
+    bell.n_parked.fetch_sub(1);
+  }
+
+  std::shared_ptr<State> s;
+};
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "memory_region.hxx"
+#include "provider/shm/segment.hxx"
+
+namespace dpx::trans::shm {
+
+// A single-producer single-consumer byte stream over a RingState and a data region of a segment. Each process holds
+// its own Ring over its own mapping and uses it either as the producer or as the consumer. The position of the other
+// side is cached, so the shared cache lines are only touched when the ring looks full or empty.
+class Ring {
+ public:
+  Ring(RingState& s_, MemoryRegion data_) : s(s_), data(data_), mask(data_.size() - 1) {}
+
+  size_t capacity() const { return data.size(); }
+
+  // copies as much of `src` as fits, returns the number of bytes written
+  size_t write(const uint8_t* src, size_t n) {
+    auto tail = s.tail.load(std::memory_order_relaxed);
+    if (tail - peer_pos + n > capacity()) {
+      peer_pos = s.head.load(std::memory_order_acquire);
+    }
+    n = std::min(n, capacity() - (tail - peer_pos));
+    if (n == 0) {
+      return 0;
+    }
+    auto off = tail & mask;
+    auto first = std::min(n, capacity() - off);
+    std::memcpy(data.data() + off, src, first);
+    std::memcpy(data.data(), src + first, n - first);
+    s.tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // copies up to `n` bytes out, returns the number of bytes read
+  size_t read(uint8_t* dst, size_t n) {
+    auto head = s.head.load(std::memory_order_relaxed);
+    if (peer_pos - head < n) {
+      peer_pos = s.tail.load(std::memory_order_acquire);
+    }
+    n = std::min(n, peer_pos - head);
+    if (n == 0) {
+      return 0;
+    }
+    auto off = head & mask;
+    auto first = std::min(n, capacity() - off);
+    std::memcpy(dst, data.data() + off, first);
+    std::memcpy(dst + first, data.data(), n - first);
+    s.head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  bool writable() const {
+    return s.tail.load(std::memory_order_relaxed) - s.head.load(std::memory_order_acquire) < capacity();
+  }
+
+  bool readable() const { return s.tail.load(std::memory_order_acquire) != s.head.load(std::memory_order_relaxed); }
+
+ private:
+  RingState& s;
+  MemoryRegion data;
+  uint64_t mask;
+  uint64_t peer_pos = 0;  // last seen head of the producer, or tail of the consumer
+};
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,125 @@
+#include "provider/shm/segment.hxx"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cassert>
+#include <new>
+#include <system_error>
+
+#include "util/fatal.hxx"
+#include "util/upper_align.hxx"
+
+namespace dpx::trans::shm {
+
+namespace {
+
+constexpr size_t page_size = 4096;
+
+MemoryRegion map(int fd, size_t len) {
+  auto addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    die("Fail to map {} bytes of shm segment, errno: {}", len, errno);
+  }
+  return MemoryRegion(addr, len);
+}
+
+[[noreturn]] void refuse(const std::string& name) {
+  throw std::system_error(std::make_error_code(std::errc::connection_refused), "shm segment " + name);
+}
+
+}  // namespace
+
+size_t Segment::data_offset() { return upper_align(sizeof(SegmentHeader), page_size); }
+
+Segment Segment::create(std::string name, size_t ring_capacity) {
+  if (!std::has_single_bit(ring_capacity) || ring_capacity < page_size) {
+    die("Ring capacity must be a power of two of at least {} bytes, got {}", page_size, ring_capacity);
+  }
+  shm_unlink(name.c_str());
+  auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    die("Fail to create shm segment {}, errno: {}", name, errno);
+  }
+  // released by the kernel whenever this process goes away
+  if (flock(fd, LOCK_EX) != 0) {
+    auto err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    die("Fail to lock shm segment {}, errno: {}", name, err);
+  }
+  auto len = data_offset() + 2 * ring_capacity;
+  if (ftruncate(fd, len) != 0) {
+    auto err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    die("Fail to resize shm segment {} to {} bytes, errno: {}", name, len, err);
+  }
+  auto mr = map(fd, len);
+  auto h = new (mr.raw_data()) SegmentHeader();
+  h->ring_capacity = ring_capacity;
+  return Segment(std::move(name), mr, fd);
+}
+
+Segment Segment::open(std::string name) {
+  auto fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    refuse(name);
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < data_offset()) {
+    // the server has not sized it yet
+    close(fd);
+    refuse(name);
+  }
+  // a crashed server leaves its segments listening but unlocked, the live one replaces them soon
+  auto orphaned = flock(fd, LOCK_SH | LOCK_NB) == 0;
+  auto mr = map(fd, st.st_size);
+  close(fd);
+  Segment s(std::move(name), mr);
+  auto& h = s.header();
+  if (h.state.load(std::memory_order_acquire) == SegmentHeader::Created) {
+    refuse(s.n);
+  }
+  if (h.magic != SegmentHeader::magic_v || data_offset() + 2 * h.ring_capacity != mr.size()) {
+    die("Malformed shm segment {}", s.n);
+  }
+  if (orphaned) {
+    refuse(s.n);
+  }
+  return s;
+}
+
+void Segment::unlink(const std::string& name) { shm_unlink(name.c_str()); }
+
+Segment& Segment::operator=(Segment&& other) noexcept {
+  if (this != &other) {
+    release();
+    n = std::move(other.n);
+    base = std::exchange(other.base, MemoryRegion());
+    fd = std::exchange(other.fd, -1);
+  }
+  return *this;
+}
+
+Segment::~Segment() { release(); }
+
+void Segment::release() {
+  if (!base.empty()) {
+    munmap(base.raw_data(), base.size());
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+MemoryRegion Segment::ring_data(Side producer) {
+  auto capacity = header().ring_capacity;
+  return base.sub_region(data_offset() + SegmentHeader::idx(producer) * capacity, capacity);
+}
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "def.hxx"
+#include "memory_region.hxx"
+#include "util/noncopyable.hxx"
+
+namespace dpx::trans::shm {
+
+// The futex word a side parks on. The peer rings it after producing into or consuming from a ring, whenever the side
+// has parked operations.
+struct alignas(64) Doorbell {
+  std::atomic<uint32_t> seq = 0;
+  std::atomic<uint32_t> n_parked = 0;
+};
+
+// Positions grow without wrapping, the producer and the consumer own one cache line each.
+struct RingState {
+  alignas(64) std::atomic<uint64_t> head = 0;
+  alignas(64) std::atomic<uint64_t> tail = 0;
+};
+
+// The start of a segment, followed by the data of both rings. It is mapped at different addresses in both processes,
+// so nothing in it is a pointer.
+struct SegmentHeader {
+  constexpr static uint64_t magic_v = 0x314d48532d585044;  // "DPX-SHM1"
+
+  enum State : uint32_t {
+    Created,
+    Listening,
+    Connected,
+  };
+
+  static size_t idx(Side side) { return side == Side::ClientSide ? 0 : 1; }
+
+  uint64_t magic = magic_v;
+  uint64_t ring_capacity = 0;
+  std::atomic<uint32_t> state = Created;
+  std::array<std::atomic<uint32_t>, 2> closed{};  // by side
+  std::array<Doorbell, 2> doorbells;              // by side
+  std::array<RingState, 2> rings;                 // by producer side
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// A named POSIX shared memory segment holding a pair of rings, mapped for the lifetime of the object.
+// The creating side holds a lock on it for as long, so a segment left behind by a process that is gone is told apart
+// from a live one, across pid namespaces as well.
+class Segment : Noncopyable {
+ public:
+  // creates, locks and maps a zeroed segment in the Created state, replacing a stale one of the same name
+  static Segment create(std::string name, size_t ring_capacity);
+  // maps an existing segment, throws std::system_error with connection_refused if it is missing, not listening, or
+  // left behind by a server side that is gone
+  static Segment open(std::string name);
+  static void unlink(const std::string& name);
+
+  Segment(Segment&& other) noexcept
+      : n(std::move(other.n)), base(std::exchange(other.base, MemoryRegion())), fd(std::exchange(other.fd, -1)) {}
+  Segment& operator=(Segment&& other) noexcept;
+  ~Segment();
+
+  const std::string& name() const { return n; }
+
+  SegmentHeader& header() { return *reinterpret_cast<SegmentHeader*>(base.data()); }
+
+  // data of the ring written by `producer`
+  MemoryRegion ring_data(Side producer);
+
+ private:
+  Segment(std::string name_, MemoryRegion base_, int fd_ = -1) : n(std::move(name_)), base(base_), fd(fd_) {}
+
+  static size_t data_offset();
+  void release();
+
+  std::string n;
+  MemoryRegion base;
+  int fd = -1;  // holds the lock of the creating side
+};
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,85 @@
+#include "provider/shm/waiter.hxx"
+
+#include <cerrno>
+
+#include "util/futex.hxx"
+
+namespace dpx::trans::shm {
+
+Waiter::Waiter(asio::io_context& io) : asio::io_context::service(io) {}
+
+void Waiter::park(std::atomic<uint32_t>& word, uint32_t seq, asio::any_completion_handler<void()> handler) {
+  {
+    std::lock_guard l(mu);
+    parked.emplace_back(Parked{&word, seq, std::move(handler), asio::make_work_guard(get_io_context())});
+    if (!thread.joinable()) {
+      thread = std::thread([this]() { wait_loop(); });
+    }
+  }
+  wake_up();
+}
+
+void Waiter::wake_up() {
+  kick.fetch_add(1);
+  futex_wake(kick);
+  cv.notify_one();
+}
+
+void Waiter::shutdown() {
+  {
+    std::lock_guard l(mu);
+    stopping = true;
+  }
+  wake_up();
+  if (thread.joinable()) {
+    thread.join();
+  }
+  // the io_context is going away, parked operations are destroyed along with their coroutines
+  parked.clear();
+}
+
+void Waiter::wait_loop() {
+  auto waitv_supported = true;
+  std::vector<::futex_waitv> words;
+  std::vector<Parked> rest;
+  std::unique_lock l(mu);
+  while (true) {
+    cv.wait(l, [this]() { return stopping || !parked.empty(); });
+    if (stopping) {
+      break;
+    }
+    // the kick comes first, a newly parked operation ends the wait and is waited on in the next round
+    words.clear();
+    words.push_back(futex_waiter(kick, kick.load()));
+    for (auto i = 0uz; i < parked.size() && words.size() < FUTEX_WAITV_MAX; ++i) {
+      words.push_back(futex_waiter(*parked[i].word, parked[i].seq));
+    }
+    l.unlock();
+    auto timed_out = false;
+    if (waitv_supported) {
+      if (futex_wait_any(words, timeout) < 0) {
+        timed_out = (errno == ETIMEDOUT);
+        waitv_supported = (errno != ENOSYS);
+      }
+    } else {
+      // the first parked operation only
+      auto word = reinterpret_cast<std::atomic<uint32_t>*>(words[1].uaddr);
+      timed_out = !futex_wait(*word, static_cast<uint32_t>(words[1].val), timeout);
+    }
+    l.lock();
+    if (stopping) {
+      break;
+    }
+    for (auto& p : parked) {
+      if (!timed_out && p.word->load() == p.seq) {
+        rest.emplace_back(std::move(p));
+      } else {
+        asio::post(get_io_context(), std::move(p.handler));
+      }
+    }
+    parked.swap(rest);
+    rest.clear();
+  }
+}
+
+}  // namespace dpx::trans::shm
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <linux/futex.h>
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dpx::trans::shm {
+
+// Resumes the parked operations of all shm endpoints of one io_context. A single thread, started by the first parked
+// operation, futex-waits on all their doorbells at once and posts an operation back once its doorbell rings, or after
+// `timeout` at the latest.
+// Beyond FUTEX_WAITV_MAX - 1 parked operations, or on kernels without futex_waitv (before 5.16), operations that are
+// not waited on are only resumed on timeout.
+class Waiter : public asio::io_context::service {
+  struct Parked {
+    std::atomic<uint32_t>* word;
+    uint32_t seq;
+    asio::any_completion_handler<void()> handler;
+    asio::executor_work_guard<asio::io_context::executor_type> work;
+  };
+
+ public:
+  using key_type = Waiter;
+  inline static asio::io_context::id id;
+
+  // parked operations recheck the rings at least this often
+  constexpr static auto timeout = std::chrono::milliseconds(10);
+
+  explicit Waiter(asio::io_context& io);
+  ~Waiter() = default;
+
+  // `handler` runs on the io_context once `word` no longer holds `seq`, `word` must stay valid until then
+  void park(std::atomic<uint32_t>& word, uint32_t seq, asio::any_completion_handler<void()> handler);
+
+ private:
+  void shutdown() override;
+  void wait_loop();
+  void wake_up();
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<Parked> parked;
+  // rung when an operation parks, so the waiting thread picks it up
+  std::atomic<uint32_t> kick = 0;
+  bool stopping = false;
+  std::thread thread;
+};
+
+}  // namespace dpx::trans::shm
@@ -6,6 +6,7 @@
 
 #include "def.hxx"
 #include "provider/tcp/endpoint.hxx"
+#include "runtime.hxx"
 
 namespace dpx::trans::tcp {
 
@@ -36,23 +37,49 @@ class Connector {
   std::vector<Endpoint> accept(asio::io_context& io, size_t n)
     requires(side == Side::ServerSide)
   {
+    return do_accept(io, [&](size_t) -> asio::io_context& { return io; }, n);
+  }
+
+  // the i-th endpoint is owned by the (i % rt.size())-th io thread of the runtime
+  std::vector<Endpoint> accept(Runtime& rt, size_t n)
+    requires(side == Side::ServerSide)
+  {
+    return do_accept(rt.io(0), [&](size_t i) -> asio::io_context& { return rt.io(i); }, n);
+  }
+
+  std::vector<Endpoint> connect(asio::io_context& io, size_t n)
+    requires(side == Side::ClientSide)
+  {
+    return do_connect([&](size_t) -> asio::io_context& { return io; }, n);
+  }
+
+  // the i-th endpoint is owned by the (i % rt.size())-th io thread of the runtime
+  std::vector<Endpoint> connect(Runtime& rt, size_t n)
+    requires(side == Side::ClientSide)
+  {
+    return do_connect([&](size_t i) -> asio::io_context& { return rt.io(i); }, n);
+  }
+
+ private:
+  template <typename IoOf>
+  std::vector<Endpoint> do_accept(asio::io_context& io, IoOf&& io_of, size_t n) {
     auto local = asio::ip::tcp::endpoint(asio::ip::address_v4::from_string(info.local_ip), info.local_port);
     asio::ip::tcp::acceptor a(io, local);
     a.set_option(asio::ip::tcp::acceptor::reuse_address(true));
     std::vector<Endpoint> conns;
     for (auto i = 0uz; i < n; i++) {
-      asio::ip::tcp::socket s = a.accept();
+      asio::ip::tcp::socket s(io_of(i));
+      a.accept(s);
       conns.emplace_back(std::move(s));
     }
     return conns;
   }
 
-  std::vector<Endpoint> connect(asio::io_context& io, size_t n)
-    requires(side == Side::ClientSide)
-  {
+  template <typename IoOf>
+  std::vector<Endpoint> do_connect(IoOf&& io_of, size_t n) {
     auto local = asio::ip::tcp::endpoint(asio::ip::address_v4::from_string(info.local_ip), info.local_port);
     auto remote = asio::ip::tcp::endpoint(asio::ip::address_v4::from_string(info.remote_ip), info.remote_port);
-    auto do_connect_one = [&]() {
+    auto do_connect_one = [&](asio::io_context& io) {
       asio::ip::tcp::socket s(io);
       s.open(asio::ip::tcp::v4());
       s.bind(local);
@@ -62,12 +89,11 @@ class Connector {
     };
     std::vector<Endpoint> conns;
     for (auto i = 0uz; i < n; i++) {
-      conns.emplace_back(do_connect_one());
+      conns.emplace_back(do_connect_one(io_of(i)));
     }
     return conns;
   }
 
- private:
   ConnectionInfo info;
 };
 
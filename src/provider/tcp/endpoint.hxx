@@ -1,9 +1,18 @@
 #pragma once
 
+#include <array>
 #include <asio.hpp>
+#include <format>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
 
 #include "def.hxx"
 #include "memory_region.hxx"
+#include "provider/tcp/uring_batcher.hxx"
+#include "stats.hxx"
+#include "util/fatal.hxx"
 #include "util/logger.hxx"
 #include "util/noncopyable.hxx"
 #include "util/unreachable.hxx"
@@ -12,32 +21,126 @@ namespace dpx::trans::tcp {
 
 class Endpoint : Noncopyable {
  public:
-  explicit Endpoint(asio::ip::tcp::socket conn_) : conn(std::move(conn_)) {}
+  // max number of regions in one scatter-gather post
+  constexpr static size_t max_iov = 16;
+
+  explicit Endpoint(asio::ip::tcp::socket conn_)
+      : conn(std::move(conn_)), stats(std::make_unique<EndpointStats>(describe(conn))) {}
 
   ~Endpoint() { conn.close(); };
 
-  Endpoint(Endpoint&& other) : conn(std::move(other.conn)) {}
+  Endpoint(Endpoint&& other)
+      : conn(std::move(other.conn)), batcher(std::exchange(other.batcher, nullptr)), stats(std::move(other.stats)) {}
   Endpoint& operator=(Endpoint&& other) {
     if (this != &other) {
       conn = std::move(other.conn);
+      batcher = std::exchange(other.batcher, nullptr);
+      stats = std::move(other.stats);
     }
     return *this;
   }
 
+  asio::any_io_executor get_executor() { return conn.get_executor(); }
+
+  // e.g. "tcp 127.0.0.1:10086 -> 127.0.0.1:10087"
+  const std::string& name() const { return stats->name; }
+
+  // pending operations are aborted
+  void close() {
+    if (batcher != nullptr) {
+      // closing does not cancel operations already in the ring, a shutdown wakes them up with eof
+      asio::error_code ec;
+      conn.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    }
+    conn.close();
+  }
+
+  // routes posts through the batcher, which must run on the same io_context; nullptr switches back
+  void set_batcher(UringBatcher* batcher_) { batcher = batcher_; }
+
+  bool is_batching() const { return batcher != nullptr; }
+
   template <Op op>
   asio::awaitable<size_t> post(MemoryRegion& mr) {
     LOG_DEBUG("tcp post {} {}", op, mr);
-    if constexpr (op == Op::Send || op == Op::Write) {
-      co_return co_await asio::async_write(conn, asio::const_buffer(mr.raw_data(), mr.size()), asio::use_awaitable);
-    } else if constexpr (op == Op::Recv || op == Op::Read) {
-      co_return co_await asio::async_read(conn, asio::mutable_buffer(mr.raw_data(), mr.size()), asio::use_awaitable);
-    } else {
-      static_unreachable;
+    OpProbe probe(stats->of<op>());
+    size_t n = 0;
+    try {
+      if (batcher != nullptr) {
+        n = co_await batcher->post<op>(conn.native_handle(), mr);
+      } else if constexpr (op == Op::Send || op == Op::Write) {
+        n = co_await asio::async_write(conn, asio::const_buffer(mr.raw_data(), mr.size()), asio::use_awaitable);
+      } else if constexpr (op == Op::Recv || op == Op::Read) {
+        n = co_await asio::async_read(conn, asio::mutable_buffer(mr.raw_data(), mr.size()), asio::use_awaitable);
+      } else {
+        static_unreachable;
+      }
+    } catch (const std::system_error& err) {
+      cancel_on_close(probe, err.code());
+      throw;
     }
+    probe.done(n);
+    co_return n;
+  }
+
+  // gathered write or scattered read of all regions in one operation
+  template <Op op>
+  asio::awaitable<size_t> post(std::span<MemoryRegion> mrs) {
+    LOG_DEBUG("tcp post {} {} regions", op, mrs.size());
+    if (mrs.size() > max_iov) {
+      auto n = mrs.size();
+      die("Too many regions: {}, max: {}", n, max_iov);
+    }
+    OpProbe probe(stats->of<op>());
+    size_t n = 0;
+    try {
+      if (batcher != nullptr) {
+        n = co_await batcher->post<op>(conn.native_handle(), mrs);
+      } else if constexpr (op == Op::Send || op == Op::Write) {
+        std::array<asio::const_buffer, max_iov> bufs;
+        for (auto i = 0uz; i < mrs.size(); ++i) {
+          bufs[i] = asio::const_buffer(mrs[i].raw_data(), mrs[i].size());
+        }
+        n = co_await asio::async_write(conn, std::span(bufs.data(), mrs.size()), asio::use_awaitable);
+      } else if constexpr (op == Op::Recv || op == Op::Read) {
+        std::array<asio::mutable_buffer, max_iov> bufs;
+        for (auto i = 0uz; i < mrs.size(); ++i) {
+          bufs[i] = asio::mutable_buffer(mrs[i].raw_data(), mrs[i].size());
+        }
+        n = co_await asio::async_read(conn, std::span(bufs.data(), mrs.size()), asio::use_awaitable);
+      } else {
+        static_unreachable;
+      }
+    } catch (const std::system_error& err) {
+      cancel_on_close(probe, err.code());
+      throw;
+    }
+    probe.done(n);
+    co_return n;
   }
 
  private:
+  // the end of a connection is not an error
+  static void cancel_on_close(OpProbe& probe, const asio::error_code& ec) {
+    if (ec == asio::error::eof || ec == asio::error::operation_aborted) {
+      probe.cancel();
+    }
+  }
+
+  static std::string describe(const asio::ip::tcp::socket& s) {
+    asio::error_code ec;
+    auto local = s.local_endpoint(ec);
+    auto remote = s.remote_endpoint(ec);
+    if (ec) {
+      return "tcp";
+    }
+    return std::format("tcp {}:{} -> {}:{}", local.address().to_string(), local.port(), remote.address().to_string(),
+                       remote.port());
+  }
+
   asio::ip::tcp::socket conn;
+  UringBatcher* batcher = nullptr;
+  std::unique_ptr<EndpointStats> stats;
 };
 
 }  // namespace dpx::trans::tcp
@@ -0,0 +1,331 @@
+#include "provider/tcp/uring_batcher.hxx"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+
+namespace dpx::trans::tcp {
+
+namespace {
+
+void skip_empty(auto* r) {
+  while (r->iov_idx < r->n_iov && r->iov[r->iov_idx].iov_len == 0) {
+    ++r->iov_idx;
+  }
+}
+
+int create_eventfd() {
+  auto fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    die("Fail to create eventfd, errno: {}", errno);
+  }
+  return fd;
+}
+
+}  // namespace
+
+UringBatcher::UringBatcher(asio::io_context& io_, unsigned entries) : io(io_), efd(io_, create_eventfd()) {
+  if (auto ec = io_uring_queue_init(entries, &ring, 0); ec < 0) {
+    auto err = -ec;
+    die("Fail to init io_uring with {} entries, errno: {}", entries, err);
+  }
+  if (auto ec = io_uring_register_eventfd(&ring, efd.native_handle()); ec < 0) {
+    auto err = -ec;
+    die("Fail to register eventfd to io_uring, errno: {}", err);
+  }
+}
+
+bool UringBatcher::supported() {
+  io_uring probe;
+  if (io_uring_queue_init(2, &probe, 0) < 0) {
+    return false;
+  }
+  io_uring_queue_exit(&probe);
+  return true;
+}
+
+UringBatcher::~UringBatcher() {
+  if (pool != nullptr) {
+    pool->remove_chunk_listener(chunk_listener);
+  }
+  if (!requests.empty() && free_requests.size() != requests.size()) {
+    LOG_WARN("{} operations are still in flight", requests.size() - free_requests.size());
+  }
+  io_uring_queue_exit(&ring);
+}
+
+void UringBatcher::register_buffers(std::span<const MemoryRegion> mrs) {
+  if (mrs.size() > max_fixed_buffers) {
+    auto n = mrs.size();
+    die("Too many fixed buffers: {}, max: {}", n, max_fixed_buffers);
+  }
+  if (registered) {
+    io_uring_unregister_buffers(&ring);
+    registered = false;
+  }
+  fixed_buffers.clear();
+  // a sparse table, empty slots are filled in by add_fixed_buffer
+  std::vector<iovec> iovs(max_fixed_buffers, iovec{.iov_base = nullptr, .iov_len = 0});
+  for (auto i = 0uz; i < mrs.size(); ++i) {
+    iovs[i] = iovec{.iov_base = const_cast<void*>(mrs[i].raw_data()), .iov_len = mrs[i].size()};
+    fixed_buffers.push_back(FixedBuffer{.mr = mrs[i], .slot = static_cast<int>(i)});
+  }
+  if (auto ec = io_uring_register_buffers_tags(&ring, iovs.data(), nullptr, iovs.size()); ec < 0) {
+    // kernels before 5.13 have no sparse tables, and a low RLIMIT_MEMLOCK refuses the pinning
+    LOG_WARN("Fail to register {} fixed buffers, errno: {}, reads go without them", mrs.size(), -ec);
+    fixed_buffers.clear();
+    return;
+  }
+  registered = true;
+  n_slots = mrs.size();
+  std::sort(fixed_buffers.begin(), fixed_buffers.end(),
+            [](const auto& l, const auto& r) { return l.mr.address() < r.mr.address(); });
+}
+
+void UringBatcher::register_pool(BufferPool& pool_) {
+  if (pool != nullptr) {
+    pool->remove_chunk_listener(chunk_listener);
+  }
+  pool = &pool_;
+  // listen before taking the snapshot, add_fixed_buffer skips chunks seen twice
+  chunk_listener = pool->add_chunk_listener([this, token = std::weak_ptr(alive)](const MemoryRegion& chunk) {
+    // the batcher may be gone by the time the registration runs
+    asio::post(io, [this, token, chunk]() {
+      if (!token.expired()) {
+        add_fixed_buffer(chunk);
+      }
+    });
+  });
+  auto chunks = pool->chunks();
+  register_buffers(chunks);
+}
+
+void UringBatcher::add_fixed_buffer(const MemoryRegion& mr) {
+  auto it = std::lower_bound(fixed_buffers.begin(), fixed_buffers.end(), mr.address(),
+                             [](const auto& l, uintptr_t r) { return l.mr.address() < r; });
+  if (it != fixed_buffers.end() && it->mr.address() == mr.address()) {
+    return;
+  }
+  if (!registered) {
+    return;
+  }
+  if (n_slots == max_fixed_buffers) {
+    LOG_WARN("No slot left for fixed buffer {}, it is used unregistered", mr);
+    return;
+  }
+  iovec v{.iov_base = const_cast<void*>(mr.raw_data()), .iov_len = mr.size()};
+  if (auto ec = io_uring_register_buffers_update_tag(&ring, n_slots, &v, nullptr, 1); ec < 0) {
+    LOG_WARN("Fail to register fixed buffer {}, errno: {}, it is used unregistered", mr, -ec);
+    return;
+  }
+  fixed_buffers.insert(it, FixedBuffer{.mr = mr, .slot = static_cast<int>(n_slots++)});
+}
+
+asio::awaitable<void> UringBatcher::run() {
+  running = true;
+  while (running) {
+    auto [ec] = co_await efd.async_wait(asio::posix::stream_descriptor::wait_read, asio::as_tuple(asio::use_awaitable));
+    if (ec == asio::error::operation_aborted) {
+      break;
+    } else if (ec) {
+      throw std::system_error(ec);
+    }
+    uint64_t n = 0;
+    while (::read(efd.native_handle(), &n, sizeof(n)) > 0) {
+    }
+    reap();
+  }
+}
+
+void UringBatcher::stop() {
+  running = false;
+  efd.cancel();
+}
+
+UringBatcher::Request* UringBatcher::acquire_request() {
+  if (free_requests.empty()) {
+    requests.emplace_back(std::make_unique<Request>());
+    return requests.back().get();
+  }
+  auto r = free_requests.back();
+  free_requests.pop_back();
+  return r;
+}
+
+void UringBatcher::release_request(Request* r) {
+  r->iov_idx = 0;
+  r->transferred = 0;
+  r->polling = false;
+  free_requests.push_back(r);
+}
+
+int UringBatcher::fixed_index(const iovec& v) const {
+  auto addr = reinterpret_cast<uintptr_t>(v.iov_base);
+  auto it = std::upper_bound(fixed_buffers.begin(), fixed_buffers.end(), addr,
+                             [](uintptr_t l, const auto& r) { return l < r.mr.address(); });
+  if (it == fixed_buffers.begin()) {
+    return -1;
+  }
+  --it;
+  return it->mr.contain(MemoryRegion(addr, v.iov_len)) ? it->slot : -1;
+}
+
+io_uring_sqe* UringBatcher::get_sqe() {
+  auto sqe = io_uring_get_sqe(&ring);
+  if (sqe == nullptr) {
+    // the submission queue is full, submit what we have
+    flush();
+    sqe = io_uring_get_sqe(&ring);
+    if (sqe == nullptr) {
+      die("Fail to get sqe from io_uring");
+    }
+  }
+  return sqe;
+}
+
+void UringBatcher::start(Request* r) {
+  skip_empty(r);
+  if (r->iov_idx == r->n_iov) {
+    complete(r, {});
+  } else {
+    prepare(r);
+  }
+}
+
+void UringBatcher::prepare(Request* r) {
+  auto sqe = get_sqe();
+  auto& v = r->iov[r->iov_idx];
+  if (r->n_iov - r->iov_idx == 1) {
+    if (r->write) {
+      // write_fixed cannot carry MSG_NOSIGNAL, a reset peer would raise SIGPIPE
+      io_uring_prep_send(sqe, r->fd, v.iov_base, v.iov_len, MSG_NOSIGNAL);
+    } else {
+      if (auto idx = fixed_index(v); idx >= 0) {
+        io_uring_prep_read_fixed(sqe, r->fd, v.iov_base, v.iov_len, 0, idx);
+        ++s.n_fixed;
+      } else {
+        io_uring_prep_recv(sqe, r->fd, v.iov_base, v.iov_len, 0);
+      }
+    }
+  } else {
+    r->msg = {};
+    r->msg.msg_iov = &v;
+    r->msg.msg_iovlen = r->n_iov - r->iov_idx;
+    if (r->write) {
+      io_uring_prep_sendmsg(sqe, r->fd, &r->msg, MSG_NOSIGNAL);
+    } else {
+      io_uring_prep_recvmsg(sqe, r->fd, &r->msg, 0);
+    }
+  }
+  push(sqe, r);
+}
+
+void UringBatcher::poll(Request* r) {
+  auto sqe = get_sqe();
+  io_uring_prep_poll_add(sqe, r->fd, r->write ? POLLOUT : POLLIN);
+  r->polling = true;
+  ++s.n_polls;
+  push(sqe, r);
+}
+
+void UringBatcher::push(io_uring_sqe* sqe, Request* r) {
+  io_uring_sqe_set_data(sqe, r);
+  ++n_unsubmitted;
+  ++s.n_sqes;
+  // submit after the other handlers of this round have posted their operations
+  if (!flush_scheduled) {
+    flush_scheduled = true;
+    asio::post(io, [this]() { flush(); });
+  }
+}
+
+void UringBatcher::flush() {
+  flush_scheduled = false;
+  if (n_unsubmitted == 0) {
+    return;
+  }
+  if (auto ec = io_uring_submit(&ring); ec < 0) {
+    auto err = -ec;
+    die("Fail to submit {} sqes, errno: {}", n_unsubmitted, err);
+  }
+  n_unsubmitted = 0;
+  ++s.n_submits;
+}
+
+void UringBatcher::reap() {
+  std::array<io_uring_cqe*, reap_batch_size> cqes;
+  std::array<std::pair<Request*, int>, reap_batch_size> done;
+  while (true) {
+    auto n = io_uring_peek_batch_cqe(&ring, cqes.data(), cqes.size());
+    if (n == 0) {
+      break;
+    }
+    for (auto i = 0u; i < n; ++i) {
+      done[i] = {reinterpret_cast<Request*>(io_uring_cqe_get_data(cqes[i])), cqes[i]->res};
+    }
+    io_uring_cq_advance(&ring, n);
+    s.n_cqes += n;
+    ++s.n_reaps;
+    for (auto i = 0u; i < n; ++i) {
+      on_complete(done[i].first, done[i].second);
+    }
+  }
+}
+
+void UringBatcher::on_complete(Request* r, int res) {
+  if (r->polling) {
+    r->polling = false;
+    // the socket is ready, errors and hang-ups are reported by the retried operation
+    if (res < 0) {
+      complete(r, asio::error_code(-res, asio::error::get_system_category()));
+    } else {
+      prepare(r);
+    }
+    return;
+  }
+  if (res == -EAGAIN) {
+    // asio leaves its sockets non-blocking, retrying at once would spin on the ring until the peer catches up
+    poll(r);
+    return;
+  }
+  if (res == -EINTR) {
+    prepare(r);
+    return;
+  }
+  if (res < 0) {
+    complete(r, asio::error_code(-res, asio::error::get_system_category()));
+    return;
+  }
+  if (res == 0 && !r->write) {
+    complete(r, asio::error::eof);
+    return;
+  }
+  r->transferred += res;
+  for (auto left = static_cast<size_t>(res); left > 0;) {
+    auto& v = r->iov[r->iov_idx];
+    if (left >= v.iov_len) {
+      left -= v.iov_len;
+      ++r->iov_idx;
+    } else {
+      v.iov_base = static_cast<uint8_t*>(v.iov_base) + left;
+      v.iov_len -= left;
+      left = 0;
+    }
+  }
+  start(r);
+}
+
+void UringBatcher::complete(Request* r, asio::error_code ec) {
+  auto handler = std::move(r->handler);
+  auto n = r->transferred;
+  release_request(r);
+  auto ex = asio::get_associated_executor(handler, io.get_executor());
+  asio::post(ex, asio::append(std::move(handler), ec, n));
+}
+
+}  // namespace dpx::trans::tcp
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <liburing.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <asio.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "buffer_pool.hxx"
+#include "def.hxx"
+#include "memory_region.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+
+namespace dpx::trans::tcp {
+
+// Posts operations of many endpoints through one io_uring owned by an io_context thread.
+// Operations posted within one round of the io_context are coalesced into a single io_uring_submit, and
+// completions are reaped in bulk when the ring signals its eventfd. Single-region reads into registered buffers use
+// the fixed-buffer opcode. Writes are always sent with MSG_NOSIGNAL, the process-wide SIGPIPE disposition is left to
+// the application. An operation on a non-blocking socket that is not ready polls it through the ring before retrying.
+// `run` must be spawned on the same io_context, all posts must come from that thread.
+class UringBatcher : Noncopyable, Nonmovable {
+  constexpr static size_t max_iov = 16;
+  constexpr static size_t reap_batch_size = 256;
+
+  struct Request {
+    int fd = -1;
+    bool write = false;
+    size_t n_iov = 0;
+    size_t iov_idx = 0;
+    size_t transferred = 0;
+    bool polling = false;
+    std::array<iovec, max_iov> iov;
+    msghdr msg;
+    asio::any_completion_handler<void(asio::error_code, size_t)> handler;
+  };
+
+  struct FixedBuffer {
+    MemoryRegion mr;
+    int slot = -1;
+  };
+
+ public:
+  struct Stats {
+    uint64_t n_sqes = 0;
+    uint64_t n_submits = 0;
+    uint64_t n_cqes = 0;
+    uint64_t n_reaps = 0;
+    uint64_t n_fixed = 0;  // sqes reading into registered buffers
+    uint64_t n_polls = 0;  // sqes waiting for a socket that was not ready
+  };
+
+  // slots of the sparse fixed-buffer table
+  constexpr static size_t max_fixed_buffers = 1024;
+
+  explicit UringBatcher(asio::io_context& io_, unsigned entries = 1024);
+  ~UringBatcher();
+
+  // whether this process can set up an io_uring, old kernels lack it and seccomp or sysctl may disable it
+  static bool supported();
+
+  // registers regions as fixed buffers, replacing the registered ones. When the kernel refuses them, reads keep being
+  // batched without fixed buffers.
+  void register_buffers(std::span<const MemoryRegion> mrs);
+
+  // keeps every chunk of the pool registered, including the ones mapped later, until another pool is registered.
+  // Chunks beyond max_fixed_buffers are used unregistered. Call it on the io thread or before the io_context runs,
+  // the pool must outlive the batcher.
+  void register_pool(BufferPool& pool);
+
+  template <Op op>
+  asio::awaitable<size_t> post(int fd, std::span<MemoryRegion> mrs) {
+    return asio::async_initiate<const asio::use_awaitable_t<>, void(asio::error_code, size_t)>(
+        [this, fd, mrs](auto handler) {
+          auto r = acquire_request();
+          r->fd = fd;
+          r->write = (op == Op::Send || op == Op::Write);
+          r->n_iov = mrs.size();
+          for (auto i = 0uz; i < mrs.size(); ++i) {
+            r->iov[i] = mrs[i];
+          }
+          r->handler = std::move(handler);
+          start(r);
+        },
+        asio::use_awaitable);
+  }
+
+  template <Op op>
+  asio::awaitable<size_t> post(int fd, MemoryRegion& mr) {
+    return post<op>(fd, std::span(&mr, 1));
+  }
+
+  // reaps completions until `stop` is called
+  asio::awaitable<void> run();
+
+  void stop();
+
+  const Stats& stats() const { return s; }
+
+  bool has_fixed_buffers() const { return registered; }
+
+ private:
+  Request* acquire_request();
+  void release_request(Request* r);
+  int fixed_index(const iovec& v) const;
+  void add_fixed_buffer(const MemoryRegion& mr);
+  io_uring_sqe* get_sqe();
+  void start(Request* r);
+  void prepare(Request* r);
+  void poll(Request* r);
+  void push(io_uring_sqe* sqe, Request* r);
+  void flush();
+  void reap();
+  void on_complete(Request* r, int res);
+  void complete(Request* r, asio::error_code ec);
+
+  asio::io_context& io;
+  io_uring ring;
+  asio::posix::stream_descriptor efd;
+  std::vector<FixedBuffer> fixed_buffers;  // sorted by address
+  bool registered = false;
+  size_t n_slots = 0;  // taken slots of the table
+  BufferPool* pool = nullptr;
+  size_t chunk_listener = 0;
+  std::shared_ptr<bool> alive = std::make_shared<bool>(true);  // expires with the batcher, for work queued on io
+  std::vector<std::unique_ptr<Request>> requests;
+  std::vector<Request*> free_requests;
+  size_t n_unsubmitted = 0;
+  bool flush_scheduled = false;
+  bool running = false;
+  Stats s;
+};
+
+}  // namespace dpx::trans::tcp
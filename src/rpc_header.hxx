@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <format>
+
+#include "concepts/rpc.hxx"
+
+namespace dpx::trans {
+
+// Wire header of every rpc frame, followed by `len` bytes of serialized payload.
+// A response carries the same id and seq as its request.
+struct RpcHeader {
+  // `crc` holds the crc32c of the payload
+  constexpr static uint32_t checksum = 1u << 0;
+  // a response whose payload is the message of the exception thrown by the handler
+  constexpr static uint32_t error = 1u << 1;
+
+  rpc_id_t id;
+  rpc_seq_t seq;
+  uint32_t len;
+  uint32_t flags;
+  uint32_t crc;
+};
+
+static_assert(sizeof(RpcHeader) == 24);
+static_assert(std::is_trivially_copyable_v<RpcHeader>);
+
+}  // namespace dpx::trans
+
+template <>
+struct std::formatter<dpx::trans::RpcHeader> : std::formatter<std::string> {
+  template <typename Context>
+  Context::iterator format(const dpx::trans::RpcHeader &h, Context out) const {
+    return std::formatter<std::string>::format(
+        std::format("rpc header: [{:#x} {} {} {:#x} {:#x}]", h.id, h.seq, h.len, h.flags, h.crc), out);
+  }
+};
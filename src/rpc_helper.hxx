@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <tuple>
 #include <variant>
 
@@ -76,4 +77,23 @@ struct GeneralHandler {
 template <typename T>
 using general_handler_t = GeneralHandler<T>::type;
 
+template <Rpc rpc, Rpc... rpcs>
+struct IndexOf {
+  static constexpr size_t value = [] {
+    constexpr std::array<bool, sizeof...(rpcs)> same = {std::is_same_v<rpc, rpcs>...};
+    for (auto i = 0uz; i < sizeof...(rpcs); ++i) {
+      if (same[i]) {
+        return i;
+      }
+    }
+    return sizeof...(rpcs);
+  }();
+};
+
+template <Rpc rpc, Rpc... rpcs>
+inline constexpr size_t index_of_v = IndexOf<rpc, rpcs...>::value;
+
+template <Rpc rpc, Rpc... rpcs>
+inline constexpr bool contains_v = index_of_v<rpc, rpcs...> < sizeof...(rpcs);
+
 }  // namespace dpx::trans
@@ -1,22 +1,438 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <asio.hpp>
+#include <asio/experimental/awaitable_operators.hpp>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "buffer_pool.hxx"
 #include "concepts/rpc.hxx"
 #include "def.hxx"
+#include "memory_region.hxx"
+#include "provider/shm/endpoint.hxx"
 #include "provider/tcp/endpoint.hxx"
+#include "rpc_header.hxx"
+#include "rpc_helper.hxx"
+#include "runtime.hxx"
+#include "serializer/zpp_bits_serializer.hxx"
+#include "stats.hxx"
+#include "util/crc32c.hxx"
+#include "util/fatal.hxx"
+#include "util/logger.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
 
 namespace dpx::trans {
 
-template <Backend b>
-class RpcTransport {
+// A pipelined rpc engine over one endpoint.
+// Client side: `call` can be issued from many coroutines at the same time, responses are matched to the waiting
+// coroutine by sequence number. `run` drives the connection and returns when the peer closes it.
+// Server side: `serve` reads frames, dispatches them by rpc id and writes responses back in completion order.
+// Handlers run inline on the endpoint's executor unless they are registered with an offload pool.
+// All coroutines of a transport must run on the executor of its endpoint.
+// Every rpc has its own OpStats, named after the endpoint and the rpc: calls on the client side, handler runs on the
+// server side.
+// With the integrity check enabled, every outgoing payload carries its crc32c, error responses included. Checksums of
+// incoming frames are verified whenever the peer sends them.
+// A request whose handler throws is answered with an error response, which `call` rethrows on the client side.
+// Broken frames (unknown rpcs, oversized payloads, undecodable requests, checksum mismatches) close the transport
+// along with its endpoint, so the peer ends as well.
+template <Backend b, Side side, Rpc... rpcs>
+class RpcTransport : Noncopyable, Nonmovable {
   // clang-format off
   using Endpoint =
     std::conditional_t<b == Backend::TCP,        tcp::Endpoint,
+    std::conditional_t<b == Backend::SHM,        shm::Endpoint,
     // std::conditional_t<b == Backend::DOCA_Comch, doca::comch::Endpoint,
     // std::conditional_t<b == Backend::DOCA_RDMA,  doca::rdma::Endpoint,
-                                                 void>
+                                                 void>>
                                                 //  >>
                                                  ;
   // clang-format on
+  static_assert(!std::is_void_v<Endpoint>, "Unsupported backend");
+  static_assert(sizeof...(rpcs) > 0, "No rpc is given");
+
+  using Handlers = std::tuple<handler_t<rpcs>...>;
+  using handle_fn = void (RpcTransport::*)(const RpcHeader&, Buffer&);
+
+  struct DispatchEntry {
+    rpc_id_t id;
+    handle_fn fn;
+  };
+
+  struct PendingCall {
+    explicit PendingCall(asio::any_io_executor ex) : signal(ex, asio::steady_timer::time_point::max()) {}
+
+    asio::steady_timer signal;
+    rpc_seq_t seq = 0;
+    Buffer payload;
+    bool done = false;
+    bool failed = false;
+  };
+
+ public:
+  // keep a frame within the 64 KiB size class of the buffer pool
+  constexpr static size_t default_max_payload_size = 64 * 1024 - sizeof(RpcHeader);
+  constexpr static size_t default_max_inflight = 64;
+
+  explicit RpcTransport(Endpoint& e_, size_t max_payload_size_ = default_max_payload_size,
+                        size_t max_inflight_ = default_max_inflight, BufferPool& pool_ = BufferPool::instance())
+      : e(e_),
+        pool(pool_),
+        max_payload_size(max_payload_size_),
+        inflight(std::bit_ceil(max_inflight_), nullptr),
+        write_signal(e.get_executor(), asio::steady_timer::time_point::max()),
+        window_signal(e.get_executor(), asio::steady_timer::time_point::max()),
+        offload_signal(e.get_executor(), asio::steady_timer::time_point::max()) {}
+
+  ~RpcTransport() = default;
+
+  void set_integrity_check(bool enabled) { integrity_check = enabled; }
+
+  bool has_integrity_check() const { return integrity_check; }
+
+  // long-running handlers can be offloaded to a pool, so they do not stall the io thread
+  template <Rpc rpc>
+  void register_handler(handler_t<rpc> handler, WorkStealingPool* offload_pool = nullptr)
+    requires(side == Side::ServerSide)
+  {
+    static_assert(contains_v<rpc, rpcs...>, "Rpc is not registered in this transport");
+    std::get<index_of_v<rpc, rpcs...>>(handlers) = std::move(handler);
+    offload_pools[index_of_v<rpc, rpcs...>] = offload_pool;
+  }
+
+  template <Rpc rpc>
+  asio::awaitable<resp_t<rpc>> call(const req_t<rpc>& req)
+    requires(side == Side::ClientSide)
+  {
+    static_assert(contains_v<rpc, rpcs...>, "Rpc is not registered in this transport");
+    static_assert(is_oneway_v<rpc> || !contains_view_v<resp_t<rpc>>,
+                  "Views in a response would outlive the receive buffer once call returns");
+    if (closed) {
+      die("Transport is closed");
+    }
+    auto seq = next_seq++;
+    OpProbe probe(*rpc_stats[index_of_v<rpc, rpcs...>]);
+    if constexpr (is_oneway_v<rpc>) {
+      probe.done(enqueue(encode<rpc>(seq, req)));
+      co_return;
+    } else {
+      auto& slot = inflight[seq & (inflight.size() - 1)];
+      while (slot != nullptr && !closed) {
+        co_await wait(window_signal);
+      }
+      if (closed) {
+        die("Transport is closed");
+      }
+      PendingCall pending(e.get_executor());
+      pending.seq = seq;
+      slot = &pending;
+      auto n = enqueue(encode<rpc>(seq, req));
+      co_await wait(pending.signal);
+      slot = nullptr;
+      window_signal.cancel();
+      if (!pending.done) {
+        die("Transport is closed before call {} completes", seq);
+      }
+      if (pending.failed) {
+        auto why = std::string(std::string_view(pending.payload));
+        die("Rpc {:#x} fails on the peer: {}", rpc::id, why);
+      }
+      auto resp = decode<rpc, resp_t<rpc>>(pending.payload);
+      probe.done(n + pending.payload.size());
+      co_return resp;
+    }
+  }
+
+  asio::awaitable<void> run()
+    requires(side == Side::ClientSide)
+  {
+    using namespace asio::experimental::awaitable_operators;
+    co_await (receive_loop() && write_loop());
+  }
+
+  asio::awaitable<void> serve()
+    requires(side == Side::ServerSide)
+  {
+    using namespace asio::experimental::awaitable_operators;
+    co_await (receive_loop() && write_loop());
+    while (n_offloading > 0) {
+      co_await wait(offload_signal);
+    }
+  }
+
+  void close() {
+    closed = true;
+    for (auto pending : inflight) {
+      if (pending != nullptr) {
+        pending->signal.cancel();
+      }
+    }
+    window_signal.cancel();
+    write_signal.cancel();
+  }
+
+  bool is_closed() const { return closed; }
+
+ private:
+  static auto wait(asio::steady_timer& signal) { return signal.async_wait(asio::as_tuple(asio::use_awaitable)); }
+
+  static constexpr auto make_dispatch_table() {
+    std::array<DispatchEntry, sizeof...(rpcs)> table = {DispatchEntry{rpcs::id, &RpcTransport::handle<rpcs>}...};
+    std::sort(table.begin(), table.end(), [](const auto& l, const auto& r) { return l.id < r.id; });
+    return table;
+  }
+
+  static constexpr bool has_unique_ids() {
+    auto table = make_dispatch_table();
+    return std::adjacent_find(table.begin(), table.end(),
+                              [](const auto& l, const auto& r) { return l.id == r.id; }) == table.end();
+  }
+
+  static handle_fn find_handle(rpc_id_t id) {
+    static_assert(has_unique_ids(), "Rpc ids conflict");
+    static constexpr auto table = make_dispatch_table();
+    auto it = std::lower_bound(table.begin(), table.end(), id, [](const auto& l, rpc_id_t r) { return l.id < r; });
+    return (it != table.end() && it->id == id) ? it->fn : nullptr;
+  }
+
+  // the peer or the local side goes away
+  static bool is_disconnect(const asio::error_code& ec) {
+    return ec == asio::error::eof || ec == asio::error::operation_aborted || ec == asio::error::broken_pipe ||
+           ec == asio::error::connection_reset;
+  }
+
+  // serializes in place after the header, into a frame of the exact encoded size when the serializer can tell it
+  template <Rpc rpc, typename T>
+  Buffer encode(rpc_seq_t seq, const T& v) {
+    using S = serializer_t<rpc>;
+    auto capacity = max_payload_size;
+    if constexpr (S::template is_sizeable<T>) {
+      capacity = S::size(v);
+      if (capacity > max_payload_size) {
+        die("Payload of rpc {:#x} is {} bytes, exceeds max payload size {}", rpc::id, capacity, max_payload_size);
+      }
+    }
+    auto frame = pool.acquire(sizeof(RpcHeader) + capacity);
+    auto len = S::serialize(frame.sub_region(sizeof(RpcHeader), capacity), v);
+    if (!len.has_value()) {
+      die("Fail to serialize rpc {:#x}, max payload size: {}", rpc::id, max_payload_size);
+    }
+    RpcHeader h{.id = rpc::id, .seq = seq, .len = static_cast<uint32_t>(len.value()), .flags = 0, .crc = 0};
+    if (integrity_check) {
+      h.flags |= RpcHeader::checksum;
+      h.crc = crc32c(frame.sub_region(sizeof(RpcHeader), len.value()));
+    }
+    std::memcpy(frame.data(), &h, sizeof(RpcHeader));
+    frame.resize(sizeof(RpcHeader) + len.value());
+    return frame;
+  }
+
+  // the message is truncated to the max payload size
+  Buffer encode_error(rpc_id_t id, rpc_seq_t seq, std::string_view why) {
+    auto len = std::min(why.size(), max_payload_size);
+    auto frame = pool.acquire(sizeof(RpcHeader) + len);
+    std::memcpy(frame.data() + sizeof(RpcHeader), why.data(), len);
+    RpcHeader h{.id = id, .seq = seq, .len = static_cast<uint32_t>(len), .flags = RpcHeader::error, .crc = 0};
+    if (integrity_check) {
+      h.flags |= RpcHeader::checksum;
+      h.crc = crc32c(frame.sub_region(sizeof(RpcHeader), len));
+    }
+    std::memcpy(frame.data(), &h, sizeof(RpcHeader));
+    return frame;
+  }
+
+  // views in the result point into `payload`
+  template <Rpc rpc, typename T>
+  T decode(const MemoryRegion& payload) {
+    T v{};
+    if (!deserializer_t<rpc>::deserialize(payload, v)) {
+      die("Fail to deserialize rpc {:#x} from {}", rpc::id, payload);
+    }
+    return v;
+  }
+
+  template <Rpc rpc>
+  void handle(const RpcHeader& h, Buffer& payload) {
+    auto req = decode<rpc, req_t<rpc>>(payload);
+    if (auto pool = offload_pools[index_of_v<rpc, rpcs...>]; pool != nullptr) {
+      n_offloading++;
+      // the payload goes along with the request, which may still refer to it
+      asio::co_spawn(e.get_executor(), handle_offloaded<rpc>(*pool, h.seq, std::move(req), std::move(payload)),
+                     asio::detached);
+      return;
+    }
+    OpProbe probe(*rpc_stats[index_of_v<rpc, rpcs...>]);
+    auto& handler = std::get<index_of_v<rpc, rpcs...>>(handlers);
+    try {
+      if constexpr (is_oneway_v<rpc>) {
+        handler(req);
+        probe.done(payload.size());
+      } else {
+        probe.done(payload.size() + enqueue(encode<rpc>(h.seq, handler(req))));
+      }
+    } catch (const std::exception& err) {
+      fail<rpc>(h.seq, err);
+    }
+  }
+
+  // one-way rpcs have nobody to answer to
+  template <Rpc rpc>
+  void fail(rpc_seq_t seq, const std::exception& err) {
+    LOG_ERROR("Handler of rpc {:#x} fails: {}", rpc::id, err.what());
+    if constexpr (!is_oneway_v<rpc>) {
+      if (!closed) {
+        enqueue(encode_error(rpc::id, seq, err.what()));
+      }
+    }
+  }
+
+  template <Rpc rpc>
+  asio::awaitable<void> handle_offloaded(WorkStealingPool& pool, rpc_seq_t seq, req_t<rpc> req, Buffer payload) {
+    OpProbe probe(*rpc_stats[index_of_v<rpc, rpcs...>]);
+    auto& handler = std::get<index_of_v<rpc, rpcs...>>(handlers);
+    try {
+      if constexpr (is_oneway_v<rpc>) {
+        co_await offload(pool, [&]() { handler(req); });
+        probe.done(payload.size());
+      } else {
+        auto resp = co_await offload(pool, [&]() { return handler(req); });
+        if (!closed) {
+          probe.done(payload.size() + enqueue(encode<rpc>(seq, resp)));
+        }
+      }
+    } catch (const std::exception& err) {
+      fail<rpc>(seq, err);
+    }
+    if (--n_offloading == 0) {
+      offload_signal.cancel();
+    }
+  }
+
+  void dispatch(const RpcHeader& h, Buffer& payload) {
+    if constexpr (side == Side::ServerSide) {
+      auto fn = find_handle(h.id);
+      if (fn == nullptr) {
+        die("Unknown rpc {:#x}", h.id);
+      }
+      (this->*fn)(h, payload);
+    } else {
+      auto pending = inflight[h.seq & (inflight.size() - 1)];
+      if (pending == nullptr || pending->seq != h.seq) {
+        die("Unexpected response {}", h);
+      }
+      pending->payload = std::move(payload);
+      pending->done = true;
+      pending->failed = (h.flags & RpcHeader::error) != 0;
+      pending->signal.cancel();
+    }
+  }
+
+  // returns the payload size of the frame
+  size_t enqueue(Buffer&& frame) {
+    auto n = frame.size() - sizeof(RpcHeader);
+    outgoing.emplace_back(std::move(frame));
+    write_signal.cancel();
+    return n;
+  }
+
+  asio::awaitable<void> receive_loop() {
+    try {
+      while (!closed) {
+        RpcHeader h;
+        MemoryRegion header(&h, sizeof(RpcHeader));
+        co_await e.template post<Op::Read>(header);
+        if (h.len > max_payload_size) {
+          die("Payload of {} exceeds max payload size {}", h, max_payload_size);
+        }
+        auto body = pool.acquire(h.len);
+        if (h.len > 0) {
+          co_await e.template post<Op::Read>(body);
+        }
+        if (h.flags & RpcHeader::checksum) {
+          if (auto crc = crc32c(body); crc != h.crc) {
+            die("Checksum mismatch of {}, got {:#x}", h, crc);
+          }
+        }
+        dispatch(h, body);
+      }
+    } catch (const std::system_error& err) {
+      teardown();
+      if (!is_disconnect(err.code())) {
+        throw;
+      }
+      LOG_DEBUG("rpc transport is closed: {}", err.what());
+    } catch (...) {
+      teardown();
+      throw;
+    }
+    teardown();
+  }
+
+  // coalesces queued frames into one gathered write
+  asio::awaitable<void> write_loop() {
+    std::array<Buffer, Endpoint::max_iov> frames;
+    std::array<MemoryRegion, Endpoint::max_iov> iov;
+    while (true) {
+      while (outgoing.empty() && !closed) {
+        co_await wait(write_signal);
+      }
+      if (closed) {
+        break;
+      }
+      auto n = 0uz;
+      for (; n < Endpoint::max_iov && !outgoing.empty(); ++n) {
+        frames[n] = std::move(outgoing.front());
+        outgoing.pop_front();
+        iov[n] = frames[n];
+      }
+      try {
+        co_await e.template post<Op::Write>(std::span(iov.data(), n));
+      } catch (const std::system_error& err) {
+        teardown();
+        if (!is_disconnect(err.code())) {
+          throw;
+        }
+        LOG_DEBUG("rpc transport is closed: {}", err.what());
+      }
+      for (auto i = 0uz; i < n; ++i) {
+        frames[i].release();
+      }
+    }
+    outgoing.clear();
+  }
+
+  // the endpoint is closed too, so the peer does not wait on a transport that is gone
+  void teardown() {
+    close();
+    e.close();
+  }
+
+  Endpoint& e;
+  BufferPool& pool;
+  size_t max_payload_size;
+  bool integrity_check = false;
+  Handlers handlers{handler_t<rpcs>(rpcs{})...};
+  std::array<WorkStealingPool*, sizeof...(rpcs)> offload_pools{};
+  std::array<std::unique_ptr<OpStats>, sizeof...(rpcs)> rpc_stats{std::make_unique<OpStats>(
+      OpStats::Kind::Rpc, std::format("{} {}", e.name(), std::string_view(rpcs::name)), rpcs::id)...};
+  size_t n_offloading = 0;
+  std::vector<PendingCall*> inflight;
+  rpc_seq_t next_seq = 0;
+  std::deque<Buffer> outgoing;
+  asio::steady_timer write_signal;
+  asio::steady_timer window_signal;
+  asio::steady_timer offload_signal;
+  bool closed = false;
 };
 
 }  // namespace dpx::trans
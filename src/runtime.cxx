@@ -0,0 +1,60 @@
+#include "runtime.hxx"
+
+#include <format>
+
+#include "buffer_pool.hxx"
+#include "util/fatal.hxx"
+#include "util/thread_util.hxx"
+
+namespace dpx::trans {
+
+Runtime::Runtime(size_t n_io_threads, size_t n_offload_workers, size_t first_core_) : first_core(first_core_) {
+  if (n_io_threads == 0) {
+    die("Runtime needs at least one io thread");
+  }
+  for (auto i = 0uz; i < n_io_threads; ++i) {
+    ios.emplace_back(std::make_unique<asio::io_context>(1));
+  }
+  if (n_offload_workers > 0) {
+    offload_pool = std::make_unique<WorkStealingPool>(n_offload_workers, first_core + n_io_threads);
+  }
+}
+
+Runtime::~Runtime() {
+  stop();
+  join();
+  // offload workers may still post completions to the io_contexts
+  offload_pool.reset();
+}
+
+void Runtime::start() {
+  if (!threads.empty()) {
+    die("Runtime is already started");
+  }
+  for (auto i = 0uz; i < ios.size(); ++i) {
+    guards.emplace_back(asio::make_work_guard(*ios[i]));
+    threads.emplace_back([this, i]() {
+      set_thread_name(std::format("dpx-io-{}", i));
+      bind_core(first_core + i);
+      ios[i]->run();
+      BufferPool::instance().flush_local_cache();
+    });
+  }
+}
+
+void Runtime::stop() {
+  guards.clear();
+  for (auto& io : ios) {
+    io->stop();
+  }
+}
+
+void Runtime::join() {
+  for (auto& t : threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+}  // namespace dpx::trans
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <asio.hpp>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/work_stealing_pool.hxx"
+
+namespace dpx::trans {
+
+// Runs `fn` on the pool, then resumes the awaiting coroutine on its own executor.
+template <typename F>
+auto offload(WorkStealingPool& pool, F&& fn) {
+  using R = std::invoke_result_t<F>;
+  if constexpr (std::is_void_v<R>) {
+    return asio::async_initiate<const asio::use_awaitable_t<>, void(std::exception_ptr)>(
+        [&pool](auto handler, auto fn) {
+          auto work = asio::make_work_guard(asio::get_associated_executor(handler));
+          pool.submit([fn = std::move(fn), handler = std::move(handler), work = std::move(work)]() mutable {
+            std::exception_ptr e;
+            try {
+              fn();
+            } catch (...) {
+              e = std::current_exception();
+            }
+            auto ex = work.get_executor();
+            asio::post(ex, asio::append(std::move(handler), e));
+          });
+        },
+        asio::use_awaitable, std::forward<F>(fn));
+  } else {
+    static_assert(std::is_default_constructible_v<R>);
+    return asio::async_initiate<const asio::use_awaitable_t<>, void(std::exception_ptr, R)>(
+        [&pool](auto handler, auto fn) {
+          auto work = asio::make_work_guard(asio::get_associated_executor(handler));
+          pool.submit([fn = std::move(fn), handler = std::move(handler), work = std::move(work)]() mutable {
+            std::exception_ptr e;
+            R r{};
+            try {
+              r = fn();
+            } catch (...) {
+              e = std::current_exception();
+            }
+            auto ex = work.get_executor();
+            asio::post(ex, asio::append(std::move(handler), e, std::move(r)));
+          });
+        },
+        asio::use_awaitable, std::forward<F>(fn));
+  }
+}
+
+// A sharded runtime with one io_context per pinned io thread, plus an optional work-stealing pool for long-running
+// handlers. Endpoints accepted or connected through a runtime are spread over its io_contexts, and everything
+// spawned on an endpoint's executor runs on the core owning it.
+class Runtime : Noncopyable, Nonmovable {
+ public:
+  // io threads are pinned to [first_core, first_core + n_io_threads), offload workers to the following cores
+  explicit Runtime(size_t n_io_threads, size_t n_offload_workers = 0, size_t first_core = 0);
+  // stops and joins all threads
+  ~Runtime();
+
+  size_t size() const { return ios.size(); }
+
+  asio::io_context& io(size_t idx) { return *ios[idx % ios.size()]; }
+
+  // starts all io threads, which keep running until `stop` even if there is no work
+  void start();
+
+  void stop();
+
+  void join();
+
+  bool has_offload_pool() const { return offload_pool != nullptr; }
+
+  WorkStealingPool& offload_workers() { return *offload_pool; }
+
+  template <typename F>
+  auto offload(F&& fn) {
+    return dpx::trans::offload(*offload_pool, std::forward<F>(fn));
+  }
+
+ private:
+  const size_t first_core;
+  std::vector<std::unique_ptr<asio::io_context>> ios;
+  std::vector<asio::executor_work_guard<asio::io_context::executor_type>> guards;
+  std::vector<std::thread> threads;
+  std::unique_ptr<WorkStealingPool> offload_pool;
+};
+
+}  // namespace dpx::trans
@@ -2,6 +2,18 @@
 
 #include <zpp_bits.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
 #include "memory_region.hxx"
 
 namespace dpx::trans {
@@ -9,9 +21,271 @@ namespace dpx::trans {
 class MemoryRegionWrapper final : public MemoryRegion {
  public:
   using value_type = uint8_t;  // zpp_bits inner traits
+
+  MemoryRegionWrapper() = default;
+  explicit MemoryRegionWrapper(const MemoryRegion &mr) : MemoryRegion(mr) {}
 };
 
-using ZppBitsSerializer = zpp::bits::out<MemoryRegionWrapper>;
-using ZppBitsDeserializer = zpp::bits::in<MemoryRegionWrapper>;
+namespace details {
+
+template <typename T>
+struct is_view : std::false_type {};
+
+template <typename C, typename Traits>
+struct is_view<std::basic_string_view<C, Traits>> : std::true_type {};
+
+template <typename T, size_t N>
+struct is_view<std::span<T, N>> : std::true_type {};
+
+// containers encoded as a size prefix followed by their elements
+template <typename T>
+struct is_sized_container : std::false_type {};
+
+template <typename C, typename Traits, typename Alloc>
+struct is_sized_container<std::basic_string<C, Traits, Alloc>> : std::true_type {};
+
+template <typename T, typename Alloc>
+  requires(!std::is_same_v<T, bool>)
+struct is_sized_container<std::vector<T, Alloc>> : std::true_type {};
+
+template <typename T>
+struct is_std_array : std::false_type {};
+
+template <typename T, size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type {};
+
+struct SerializeMember {
+  int serialize;
+};
+
+// lookup of `serialize` is ambiguous here iff T has a member of that name, function template or not
+template <typename T>
+struct SerializeProbe : T, SerializeMember {};
+
+// stands in for a zpp_bits archive when probing for serialize functions
+struct ArchiveProbe {
+  constexpr std::errc operator()(auto &&...) const { return {}; }
+};
+
+// zpp_bits custom serialization: a `serialize` member (a function or a `using serialize = members<N>` alias), or a
+// free `serialize(archive, self)` found by ADL.
+// Final classes cannot be probed for any member of that name, so only aggregates without a static
+// `serialize(archive, self)` count as plain, the others are taken as custom.
+template <typename T>
+concept HasCustomSerialize =
+    requires { typename T::serialize; } || requires { &T::serialize; } ||
+    (std::is_class_v<T> && !std::is_final_v<T> && !requires { &SerializeProbe<T>::serialize; }) ||
+    (std::is_final_v<T> && !std::is_aggregate_v<T>) ||
+    requires(T &self, ArchiveProbe &archive) { T::serialize(archive, self); } ||
+    requires(T &self, ArchiveProbe &archive) { serialize(archive, self); };
+
+// aggregates zpp_bits encodes member by member, without a custom serialize function
+template <typename T>
+concept DefaultLayout = std::is_class_v<T> && std::is_aggregate_v<T> && !HasCustomSerialize<T>;
+
+// zpp_bits default size prefix of containers and views
+using size_prefix_t = uint32_t;
+
+enum class SizeKind {
+  Unknown,  // encoded size can only be bounded by the buffer
+  Fixed,    // encoded size is known at compile time
+  Dynamic,  // encoded size depends on the value
+};
+
+template <typename... Kinds>
+constexpr SizeKind combine(Kinds... kinds) {
+  if (((kinds == SizeKind::Unknown) || ... || false)) {
+    return SizeKind::Unknown;
+  }
+  if (((kinds == SizeKind::Dynamic) || ... || false)) {
+    return SizeKind::Dynamic;
+  }
+  return SizeKind::Fixed;
+}
+
+template <typename T>
+constexpr bool contains_view() {
+  using type = std::remove_cvref_t<T>;
+  if constexpr (is_view<type>::value) {
+    return true;
+  } else if constexpr (is_sized_container<type>::value || is_std_array<type>::value) {
+    return contains_view<typename type::value_type>();
+  } else if constexpr (std::is_array_v<type>) {
+    return contains_view<std::remove_extent_t<type>>();
+  } else if constexpr (DefaultLayout<type>) {
+    return decltype(zpp::bits::access::visit_members(std::declval<type &>(), [](auto &...ms) {
+      return std::bool_constant<(false || ... || contains_view<decltype(ms)>())>{};
+    }))::value;
+  } else {
+    return false;
+  }
+}
+
+template <typename T>
+constexpr SizeKind size_kind() {
+  using type = std::remove_cvref_t<T>;
+  if constexpr (std::is_arithmetic_v<type> || std::is_enum_v<type>) {
+    return SizeKind::Fixed;
+  } else if constexpr (is_view<type>::value || is_sized_container<type>::value) {
+    return combine(SizeKind::Dynamic, size_kind<typename type::value_type>());
+  } else if constexpr (is_std_array<type>::value) {
+    return size_kind<typename type::value_type>();
+  } else if constexpr (std::is_array_v<type>) {
+    return size_kind<std::remove_extent_t<type>>();
+  } else if constexpr (DefaultLayout<type>) {
+    return decltype(zpp::bits::access::visit_members(std::declval<type &>(), [](auto &...ms) {
+      return std::integral_constant<SizeKind, combine(size_kind<decltype(ms)>()...)>{};
+    }))::value;
+  } else {
+    return SizeKind::Unknown;
+  }
+}
+
+template <typename T>
+  requires(size_kind<T>() == SizeKind::Fixed)
+constexpr size_t fixed_size() {
+  using type = std::remove_cvref_t<T>;
+  if constexpr (std::is_arithmetic_v<type> || std::is_enum_v<type>) {
+    return sizeof(type);
+  } else if constexpr (is_std_array<type>::value) {
+    return std::tuple_size_v<type> * fixed_size<typename type::value_type>();
+  } else if constexpr (std::is_array_v<type>) {
+    return std::extent_v<type> * fixed_size<std::remove_extent_t<type>>();
+  } else {
+    return decltype(zpp::bits::access::visit_members(std::declval<type &>(), [](auto &...ms) {
+      return std::integral_constant<size_t, (0uz + ... + fixed_size<decltype(ms)>())>{};
+    }))::value;
+  }
+}
+
+template <typename T>
+  requires(size_kind<T>() != SizeKind::Unknown)
+constexpr size_t encoded_size(const T &v) {
+  using type = std::remove_cvref_t<T>;
+  if constexpr (size_kind<type>() == SizeKind::Fixed) {
+    return fixed_size<type>();
+  } else if constexpr (is_view<type>::value || is_sized_container<type>::value) {
+    using value_t = std::remove_cv_t<typename type::value_type>;
+    if constexpr (size_kind<value_t>() == SizeKind::Fixed) {
+      return sizeof(size_prefix_t) + v.size() * fixed_size<value_t>();
+    } else {
+      auto n = sizeof(size_prefix_t);
+      for (const auto &e : v) {
+        n += encoded_size(e);
+      }
+      return n;
+    }
+  } else if constexpr (is_std_array<type>::value || std::is_array_v<type>) {
+    auto n = 0uz;
+    for (const auto &e : v) {
+      n += encoded_size(e);
+    }
+    return n;
+  } else {
+    return zpp::bits::access::visit_members(v, [](const auto &...ms) { return (0uz + ... + encoded_size(ms)); });
+  }
+}
+
+// whether the views in `v` point to properly aligned elements, zpp_bits places them wherever they lie in the buffer
+template <typename T>
+bool views_aligned(const T &v) {
+  using type = std::remove_cvref_t<T>;
+  if constexpr (!contains_view<type>()) {
+    return true;
+  } else if constexpr (is_view<type>::value) {
+    return v.empty() || reinterpret_cast<uintptr_t>(v.data()) % alignof(typename type::value_type) == 0;
+  } else if constexpr (is_sized_container<type>::value || is_std_array<type>::value || std::is_array_v<type>) {
+    return std::all_of(std::begin(v), std::end(v), [](const auto &e) { return views_aligned(e); });
+  } else {
+    return zpp::bits::access::visit_members(v, [](const auto &...ms) { return (true && ... && views_aligned(ms)); });
+  }
+}
+
+}  // namespace details
+
+// True if a deserialized T refers into the buffer it is deserialized from.
+template <typename T>
+inline constexpr bool contains_view_v = details::contains_view<T>();
+
+// Trivially copyable types without views are copied as they are, everything else goes through zpp_bits.
+// The copy must match what zpp_bits writes for the same value nested in another one, so types with padding, whose
+// padding bytes are uninitialized and skipped by the member-wise encoding, and types with a custom serialize are
+// excluded. Floating points have no padding but no unique representation either.
+template <typename T>
+inline constexpr bool is_memcpy_layout_v =
+    std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !contains_view_v<T> &&
+    !details::HasCustomSerialize<T> && (std::has_unique_object_representations_v<T> || std::is_floating_point_v<T>);
+
+// Serializer interface of `RpcDesc`:
+// - `is_fixed_size<T>` and `fixed_size<T>` give the exact encoded size at compile time.
+// - `is_sizeable<T>` and `size(v)` give the exact encoded size at runtime, walking the value once.
+// - `serialize(dst, v)` encodes in place into `dst`, returns the encoded length or nullopt if `dst` is too small.
+struct ZppBitsSerializer {
+  template <typename T>
+  constexpr static bool is_fixed_size = is_memcpy_layout_v<T> || details::size_kind<T>() == details::SizeKind::Fixed;
+
+  template <typename T>
+  constexpr static bool is_sizeable = is_memcpy_layout_v<T> || details::size_kind<T>() != details::SizeKind::Unknown;
+
+  template <typename T>
+    requires is_fixed_size<T>
+  constexpr static size_t fixed_size = [] {
+    if constexpr (is_memcpy_layout_v<T>) {
+      return sizeof(T);
+    } else {
+      return details::fixed_size<T>();
+    }
+  }();
+
+  template <typename T>
+    requires is_sizeable<T>
+  constexpr static size_t size(const T &v) {
+    if constexpr (is_fixed_size<T>) {
+      return fixed_size<T>;
+    } else {
+      return details::encoded_size(v);
+    }
+  }
+
+  template <typename T>
+  static std::optional<size_t> serialize(MemoryRegion dst, const T &v) {
+    if constexpr (is_memcpy_layout_v<T>) {
+      if (dst.size() < sizeof(T)) {
+        return std::nullopt;
+      }
+      std::memcpy(dst.data(), &v, sizeof(T));
+      return sizeof(T);
+    } else {
+      MemoryRegionWrapper buffer(dst);
+      zpp::bits::out<MemoryRegionWrapper> out(buffer);
+      if (auto r = out(v); zpp::bits::failure(r)) {
+        return std::nullopt;
+      }
+      return out.position();
+    }
+  }
+};
+
+// Deserializer interface of `RpcDesc`:
+// - `deserialize(src, v)` decodes `v` from `src`, returns false if `src` is malformed.
+// Views in `v` (std::string_view, std::span) point into `src` instead of being copied, so `src` must outlive them.
+// A view whose elements would be misaligned in `src` fails the decoding, so views of elements wider than a byte need
+// the encoded value to keep them aligned.
+struct ZppBitsDeserializer {
+  template <typename T>
+  static bool deserialize(const MemoryRegion &src, T &v) {
+    if constexpr (is_memcpy_layout_v<T>) {
+      if (src.size() != sizeof(T)) {
+        return false;
+      }
+      std::memcpy(&v, src.data(), sizeof(T));
+      return true;
+    } else {
+      MemoryRegionWrapper buffer(src);
+      zpp::bits::in<MemoryRegionWrapper> in(buffer);
+      return !zpp::bits::failure(in(v)) && details::views_aligned(v);
+    }
+  }
+};
 
 }  // namespace dpx::trans
@@ -0,0 +1,80 @@
+#include "stats.hxx"
+
+#include <algorithm>
+#include <glaze/glaze.hpp>
+
+#include "util/fatal.hxx"
+
+namespace dpx::trans {
+
+OpStats::OpStats(Kind kind_, std::string name_, uint64_t rpc_id_, bool timed_)
+    : kind(kind_),
+      name(std::move(name_)),
+      rpc_id(rpc_id_),
+      timed(timed_),
+      latency(timed ? std::make_unique<AtomicHistogram>() : nullptr) {
+  StatsRegistry::instance().add(this);
+}
+
+OpStats::~OpStats() { StatsRegistry::instance().remove(this); }
+
+StatsRegistry& StatsRegistry::instance() {
+  static StatsRegistry registry;
+  return registry;
+}
+
+void StatsRegistry::add(const OpStats* s) {
+  std::lock_guard l(mu);
+  stats.push_back(s);
+}
+
+void StatsRegistry::remove(const OpStats* s) {
+  std::lock_guard l(mu);
+  std::erase(stats, s);
+}
+
+StatsSnapshot StatsRegistry::snapshot() const {
+  auto ratio = tsc_per_ns();
+  StatsSnapshot snapshot{.latency_sample_rate = latency_sample_rate, .endpoints = {}, .rpcs = {}};
+  std::lock_guard l(mu);
+  for (auto s : stats) {
+    auto h = s->latency != nullptr ? s->latency->snapshot() : Histogram();
+    auto ns = [ratio](double ticks) { return ticks / ratio; };
+    OpStatsSnapshot ss{
+        .name = s->name,
+        .rpc_id = s->rpc_id,
+        .n_ops = s->n_ops.get(),
+        .n_bytes = s->n_bytes.get(),
+        .n_errors = s->n_errors.get(),
+        .inflight = s->inflight.get(),
+        .latency =
+            LatencySnapshot{
+                .n_samples = h.count(),
+                .min_ns = ns(h.min()),
+                .mean_ns = ns(h.mean()),
+                .p50_ns = ns(h.percentile(50)),
+                .p99_ns = ns(h.percentile(99)),
+                .p999_ns = ns(h.percentile(99.9)),
+                .max_ns = ns(h.max()),
+            },
+    };
+    if (s->kind == OpStats::Kind::Endpoint) {
+      snapshot.endpoints.emplace_back(std::move(ss));
+    } else {
+      snapshot.rpcs.emplace_back(std::move(ss));
+    }
+  }
+  return snapshot;
+}
+
+std::string StatsRegistry::dump_json() const {
+  auto s = snapshot();
+  std::string json;
+  if (auto ec = glz::write_json(s, json); ec) {
+    auto why = glz::format_error(ec, json);
+    die("Fail to dump stats: {}", why);
+  }
+  return json;
+}
+
+}  // namespace dpx::trans
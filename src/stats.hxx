@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "def.hxx"
+#include "util/histogram.hxx"
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/tsc.hxx"
+
+namespace dpx::trans {
+
+// Every n-th operation has its latency traced, footprint builds trace all of them.
+#ifdef ENABLE_FOOTPRINT
+constexpr uint64_t latency_sample_rate = 1;
+#else
+constexpr uint64_t latency_sample_rate = 64;
+#endif
+static_assert(std::has_single_bit(latency_sample_rate));
+
+// A counter with one writer thread, readable from any thread.
+class Counter {
+ public:
+  void add(uint64_t n) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+  void sub(uint64_t n) { v.store(v.load(std::memory_order_relaxed) - n, std::memory_order_relaxed); }
+  uint64_t get() const { return v.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> v = 0;
+};
+
+// Counters of one endpoint, or of one rpc of a transport. All updates come from the thread owning the endpoint.
+// Stats register themselves to the StatsRegistry for their whole lifetime.
+class OpStats : Noncopyable, Nonmovable {
+ public:
+  enum class Kind : uint32_t {
+    Endpoint,
+    Rpc,
+  };
+
+  OpStats(Kind kind, std::string name, uint64_t rpc_id = 0, bool timed = true);
+  ~OpStats();
+
+  const Kind kind;
+  const std::string name;
+  const uint64_t rpc_id;
+  // untimed stats have no latency histogram
+  const bool timed;
+
+  Counter n_ops;
+  Counter n_bytes;
+  Counter n_errors;
+  Counter inflight;
+  // in tsc ticks, null for untimed stats, which saves its buckets on every endpoint
+  const std::unique_ptr<AtomicHistogram> latency;
+
+ private:
+  friend class OpProbe;
+
+  uint64_t n_started = 0;
+};
+
+// Traces one operation: in-flight depth while it lives, ops and bytes once it is done, an error if it is destroyed
+// before that unless it is cancelled, and the latency of every `latency_sample_rate`-th operation.
+class OpProbe : Noncopyable, Nonmovable {
+ public:
+  explicit OpProbe(OpStats& s_) : s(s_) {
+    s.inflight.add(1);
+    if (s.timed && (s.n_started++ & (latency_sample_rate - 1)) == 0) {
+      begin = rdtsc();
+    }
+  }
+
+  ~OpProbe() {
+    s.inflight.sub(1);
+    if (!finished) {
+      s.n_errors.add(1);
+    }
+  }
+
+  void done(uint64_t bytes) {
+    finished = true;
+    s.n_ops.add(1);
+    s.n_bytes.add(bytes);
+    if (begin != 0) {
+      s.latency->record(rdtsc() - begin);
+    }
+  }
+
+  // neither done nor failed, e.g. ended by eof or by closing the endpoint
+  void cancel() { finished = true; }
+
+ private:
+  OpStats& s;
+  uint64_t begin = 0;
+  bool finished = false;
+};
+
+// Stats of one endpoint, one OpStats per direction: "<name> read" and "<name> write". A read waits for the peer to
+// write, so its latency is mostly idle time and reads are not timed.
+struct EndpointStats : Noncopyable, Nonmovable {
+  explicit EndpointStats(std::string name_)
+      : name(std::move(name_)),
+        reads(OpStats::Kind::Endpoint, name + " read", 0, false),
+        writes(OpStats::Kind::Endpoint, name + " write") {}
+
+  template <Op op>
+  OpStats& of() {
+    if constexpr (op == Op::Send || op == Op::Write) {
+      return writes;
+    } else {
+      return reads;
+    }
+  }
+
+  const std::string name;
+  OpStats reads;
+  OpStats writes;
+};
+
+struct LatencySnapshot {
+  uint64_t n_samples;
+  double min_ns;
+  double mean_ns;
+  double p50_ns;
+  double p99_ns;
+  double p999_ns;
+  double max_ns;
+};
+
+struct OpStatsSnapshot {
+  std::string name;
+  uint64_t rpc_id;
+  uint64_t n_ops;
+  uint64_t n_bytes;
+  uint64_t n_errors;
+  uint64_t inflight;
+  LatencySnapshot latency;
+};
+
+struct StatsSnapshot {
+  uint64_t latency_sample_rate;
+  std::vector<OpStatsSnapshot> endpoints;
+  std::vector<OpStatsSnapshot> rpcs;
+};
+
+// All live OpStats of the process.
+class StatsRegistry : Noncopyable, Nonmovable {
+ public:
+  static StatsRegistry& instance();
+
+  StatsSnapshot snapshot() const;
+
+  std::string dump_json() const;
+
+ private:
+  friend class OpStats;
+
+  void add(const OpStats* s);
+  void remove(const OpStats* s);
+
+  mutable std::mutex mu;
+  std::vector<const OpStats*> stats;
+};
+
+}  // namespace dpx::trans
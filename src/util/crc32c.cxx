@@ -0,0 +1,243 @@
+#include "util/crc32c.hxx"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "util/crc.hxx"
+#include "util/fatal.hxx"
+#include "util/unreachable.hxx"
+
+namespace dpx::trans {
+
+namespace {
+
+constexpr uint32_t poly = 0x82F63B78;  // reflected
+
+using Table = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr Table make_slice_tables() {
+  Table t{};
+  for (uint32_t n = 0; n < 256; ++n) {
+    uint32_t c = n;
+    for (auto k = 0; k < 8; ++k) {
+      c = (c >> 1) ^ ((c & 1) ? poly : 0);
+    }
+    t[0][n] = c;
+  }
+  for (uint32_t n = 0; n < 256; ++n) {
+    for (auto k = 1uz; k < t.size(); ++k) {
+      t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+    }
+  }
+  return t;
+}
+
+constexpr Table slice_tables = make_slice_tables();
+
+inline uint32_t load32(const uint8_t* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t load64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// all raw functions take and return an unfinalized crc
+
+uint32_t crc32c_table(uint32_t crc, const uint8_t* p, size_t len) {
+  return crc::CRC32C()(p, len, crc, static_cast<uint32_t>(0));
+}
+
+uint32_t crc32c_slice_by_8(uint32_t crc, const uint8_t* p, size_t len) {
+  const auto& t = slice_tables;
+  for (; len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --len) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+  }
+  for (; len >= 8; len -= 8, p += 8) {
+    auto lo = crc ^ load32(p);
+    auto hi = load32(p + 4);
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^
+          t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+  for (; len > 0; --len) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+
+// Three independent crc32 streams hide the latency of the instruction, their results are combined by shifting the
+// former crc over the length of a stream with the zeros operator tables below.
+constexpr size_t long_block = 8192;
+constexpr size_t short_block = 256;
+
+using ZerosTable = std::array<std::array<uint32_t, 256>, 4>;
+
+constexpr uint32_t gf2_matrix_times(const std::array<uint32_t, 32>& mat, uint32_t vec) {
+  uint32_t sum = 0;
+  for (auto i = 0uz; vec != 0; vec >>= 1, ++i) {
+    if (vec & 1) {
+      sum ^= mat[i];
+    }
+  }
+  return sum;
+}
+
+constexpr void gf2_matrix_square(std::array<uint32_t, 32>& square, const std::array<uint32_t, 32>& mat) {
+  for (auto i = 0uz; i < 32; ++i) {
+    square[i] = gf2_matrix_times(mat, mat[i]);
+  }
+}
+
+// the operator appending len zero bytes to a crc, len must be a power of two
+constexpr std::array<uint32_t, 32> zeros_operator(size_t len) {
+  std::array<uint32_t, 32> even{};
+  std::array<uint32_t, 32> odd{};
+  odd[0] = poly;  // one zero bit
+  for (uint32_t i = 1, row = 1; i < 32; ++i, row <<= 1) {
+    odd[i] = row;
+  }
+  gf2_matrix_square(even, odd);  // two zero bits
+  gf2_matrix_square(odd, even);  // four zero bits
+  while (true) {
+    gf2_matrix_square(even, odd);
+    len >>= 1;
+    if (len == 0) {
+      return even;
+    }
+    gf2_matrix_square(odd, even);
+    len >>= 1;
+    if (len == 0) {
+      return odd;
+    }
+  }
+}
+
+constexpr ZerosTable make_zeros_table(size_t len) {
+  auto op = zeros_operator(len);
+  ZerosTable t{};
+  for (uint32_t n = 0; n < 256; ++n) {
+    t[0][n] = gf2_matrix_times(op, n);
+    t[1][n] = gf2_matrix_times(op, n << 8);
+    t[2][n] = gf2_matrix_times(op, n << 16);
+    t[3][n] = gf2_matrix_times(op, n << 24);
+  }
+  return t;
+}
+
+constexpr ZerosTable long_zeros = make_zeros_table(long_block);
+constexpr ZerosTable short_zeros = make_zeros_table(short_block);
+
+inline uint32_t shift(const ZerosTable& t, uint32_t crc) {
+  return t[0][crc & 0xff] ^ t[1][(crc >> 8) & 0xff] ^ t[2][(crc >> 16) & 0xff] ^ t[3][crc >> 24];
+}
+
+template <size_t block>
+__attribute__((target("sse4.2"))) inline void crc32c_3way(uint64_t& crc0, const uint8_t*& p, size_t& len,
+                                                         const ZerosTable& zeros) {
+  while (len >= 3 * block) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (auto end = p + block; p < end; p += 8) {
+      crc0 = _mm_crc32_u64(crc0, load64(p));
+      crc1 = _mm_crc32_u64(crc1, load64(p + block));
+      crc2 = _mm_crc32_u64(crc2, load64(p + 2 * block));
+    }
+    crc0 = shift(zeros, static_cast<uint32_t>(crc0)) ^ crc1;
+    crc0 = shift(zeros, static_cast<uint32_t>(crc0)) ^ crc2;
+    p += 2 * block;
+    len -= 3 * block;
+  }
+}
+
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(uint32_t crc, const uint8_t* p, size_t len) {
+  uint64_t crc0 = crc;
+  for (; len > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --len) {
+    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *p++);
+  }
+  crc32c_3way<long_block>(crc0, p, len, long_zeros);
+  crc32c_3way<short_block>(crc0, p, len, short_zeros);
+  for (; len >= 8; len -= 8, p += 8) {
+    crc0 = _mm_crc32_u64(crc0, load64(p));
+  }
+  for (; len > 0; --len) {
+    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *p++);
+  }
+  return static_cast<uint32_t>(crc0);
+}
+
+#endif
+
+using crc32c_fn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+crc32c_fn engine_fn(Crc32cEngine engine) {
+  switch (engine) {
+    case Crc32cEngine::Table:
+      return crc32c_table;
+    case Crc32cEngine::SliceBy8:
+      return crc32c_slice_by_8;
+    case Crc32cEngine::SSE42:
+#if defined(__x86_64__)
+      return crc32c_sse42;
+#else
+      return nullptr;
+#endif
+  }
+  unreachable();
+}
+
+Crc32cEngine detect_engine() {
+  return crc32c_engine_supported(Crc32cEngine::SSE42) ? Crc32cEngine::SSE42 : Crc32cEngine::SliceBy8;
+}
+
+// detected once, on first use, so that it is safe to use during static initialization
+Crc32cEngine best_engine() {
+  static const Crc32cEngine engine = detect_engine();
+  return engine;
+}
+
+crc32c_fn best_fn() {
+  static const crc32c_fn fn = engine_fn(best_engine());
+  return fn;
+}
+
+}  // namespace
+
+Crc32cEngine crc32c_best_engine() { return best_engine(); }
+
+bool crc32c_engine_supported(Crc32cEngine engine) {
+  switch (engine) {
+    case Crc32cEngine::Table:
+    case Crc32cEngine::SliceBy8:
+      return true;
+    case Crc32cEngine::SSE42:
+#if defined(__x86_64__)
+      return __builtin_cpu_supports("sse4.2");
+#else
+      return false;
+#endif
+  }
+  unreachable();
+}
+
+uint32_t crc32c(Crc32cEngine engine, const void* data, size_t len, uint32_t crc) {
+  if (!crc32c_engine_supported(engine)) {
+    die("Crc32c engine {} is not supported on this cpu", engine);
+  }
+  return ~engine_fn(engine)(~crc, static_cast<const uint8_t*>(data), len);
+}
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+  return ~best_fn()(~crc, static_cast<const uint8_t*>(data), len);
+}
+
+}  // namespace dpx::trans
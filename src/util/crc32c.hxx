@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "memory_region.hxx"
+#include "util/enum_formatter.hxx"
+
+namespace dpx::trans {
+
+// Runtime CRC-32C (Castagnoli) for payload integrity checks.
+// The compile-time engine in util/crc.hxx stays the one for rpc id generation.
+// All functions take and return a finalized crc, so a crc can be continued by passing the previous result.
+enum class Crc32cEngine : uint32_t {
+  Table,     // byte-at-a-time table, the engine of util/crc.hxx
+  SliceBy8,  // eight bytes per step with eight tables
+  SSE42,     // crc32 instruction, three interleaved streams
+};
+
+// the fastest engine supported by this cpu, chosen at startup
+Crc32cEngine crc32c_best_engine();
+
+bool crc32c_engine_supported(Crc32cEngine engine);
+
+uint32_t crc32c(Crc32cEngine engine, const void* data, size_t len, uint32_t crc = 0);
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+inline uint32_t crc32c(const MemoryRegion& mr, uint32_t crc = 0) { return crc32c(mr.raw_data(), mr.size(), crc); }
+
+inline uint32_t crc32c(std::span<const MemoryRegion> mrs, uint32_t crc = 0) {
+  for (const auto& mr : mrs) {
+    crc = crc32c(mr, crc);
+  }
+  return crc;
+}
+
+}  // namespace dpx::trans
+
+EnumFormatter(3, dpx::trans::Crc32cEngine, Table, SliceBy8, SSE42);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <span>
+
+namespace dpx::trans {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+// Futex words may live in memory shared between processes, so the private variants are not used.
+
+// sleeps while `word` holds `expected`, returns false on timeout
+inline bool futex_wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout) {
+  timespec ts{.tv_sec = timeout.count() / 1'000'000'000, .tv_nsec = timeout.count() % 1'000'000'000};
+  auto r = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+  return r == 0 || errno != ETIMEDOUT;
+}
+
+// sleeps while every word holds its value, returns the index of a woken word or -1 with errno set: ETIMEDOUT, EAGAIN
+// if a word has changed already, ENOSYS on kernels before 5.16
+inline long futex_wait_any(std::span<::futex_waitv> words, std::chrono::nanoseconds timeout) {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  auto deadline = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec) + timeout;
+  ts = {.tv_sec = deadline.count() / 1'000'000'000, .tv_nsec = deadline.count() % 1'000'000'000};
+  return syscall(SYS_futex_waitv, words.data(), words.size(), 0, &ts, CLOCK_MONOTONIC);
+}
+
+// `word` in the shape futex_wait_any takes
+inline ::futex_waitv futex_waiter(std::atomic<uint32_t>& word, uint32_t expected) {
+  return {.val = expected, .uaddr = reinterpret_cast<uintptr_t>(&word), .flags = FUTEX_32, .__reserved = 0};
+}
+
+inline void futex_wake(std::atomic<uint32_t>& word, int n = INT_MAX) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, n, nullptr, nullptr, 0);
+}
+
+}  // namespace dpx::trans
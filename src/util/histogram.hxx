@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace dpx::trans {
+
+// A log-linear histogram in the style of HdrHistogram: every power-of-two range is split into `sub_buckets` linear
+// buckets, so any recorded value is reported within 1/sub_buckets (~3%) of its true value, over the whole uint64 range
+// and in fixed memory.
+class Histogram {
+ public:
+  constexpr static size_t sub_bucket_bits = 5;
+  constexpr static size_t sub_buckets = 1uz << sub_bucket_bits;
+  constexpr static size_t n_buckets = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+  constexpr static size_t index_of(uint64_t v) {
+    if (v < sub_buckets) {
+      return v;
+    }
+    auto shift = std::bit_width(v) - 1 - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + ((v >> shift) - sub_buckets);
+  }
+
+  // the largest value falling into the bucket
+  constexpr static uint64_t upper_bound_of(size_t idx) {
+    if (idx < 2 * sub_buckets) {
+      return idx;
+    }
+    auto shift = idx / sub_buckets - 1;
+    auto sub = idx % sub_buckets + sub_buckets;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  void record(uint64_t v, uint64_t n = 1) {
+    counts[index_of(v)] += n;
+    total += n;
+    sum += v * n;
+    min_v = std::min(min_v, v);
+    max_v = std::max(max_v, v);
+  }
+
+  void merge(const Histogram& other) {
+    for (auto i = 0uz; i < n_buckets; ++i) {
+      counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+    min_v = std::min(min_v, other.min_v);
+    max_v = std::max(max_v, other.max_v);
+  }
+
+  void reset() { *this = Histogram(); }
+
+  uint64_t count() const { return total; }
+  uint64_t min() const { return total == 0 ? 0 : min_v; }
+  uint64_t max() const { return max_v; }
+  double mean() const { return total == 0 ? 0 : static_cast<double>(sum) / total; }
+
+  // the smallest recorded value that `p` percent of the records are less than or equal to
+  uint64_t percentile(double p) const {
+    if (total == 0) {
+      return 0;
+    }
+    auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100 * total)));
+    uint64_t seen = 0;
+    for (auto i = 0uz; i < n_buckets; ++i) {
+      seen += counts[i];
+      if (seen >= target) {
+        return std::min(upper_bound_of(i), max_v);
+      }
+    }
+    return max_v;
+  }
+
+ private:
+  friend class AtomicHistogram;
+
+  std::array<uint64_t, n_buckets> counts{};
+  uint64_t total = 0;
+  uint64_t sum = 0;
+  uint64_t min_v = std::numeric_limits<uint64_t>::max();
+  uint64_t max_v = 0;
+};
+
+// The same buckets updated by one writer thread and read by any thread. Updates are relaxed loads and stores, without
+// read-modify-write instructions, so recording costs about as much as in a plain Histogram.
+class AtomicHistogram {
+ public:
+  void record(uint64_t v) {
+    bump(counts[Histogram::index_of(v)], 1);
+    bump(total, 1);
+    bump(sum, v);
+    if (v < min_v.load(std::memory_order_relaxed)) {
+      min_v.store(v, std::memory_order_relaxed);
+    }
+    if (v > max_v.load(std::memory_order_relaxed)) {
+      max_v.store(v, std::memory_order_relaxed);
+    }
+  }
+
+  // may be torn by concurrent records, each field is consistent on its own
+  Histogram snapshot() const {
+    Histogram h;
+    for (auto i = 0uz; i < Histogram::n_buckets; ++i) {
+      h.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+    h.total = total.load(std::memory_order_relaxed);
+    h.sum = sum.load(std::memory_order_relaxed);
+    h.min_v = min_v.load(std::memory_order_relaxed);
+    h.max_v = max_v.load(std::memory_order_relaxed);
+    return h;
+  }
+
+ private:
+  static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, Histogram::n_buckets> counts{};
+  std::atomic<uint64_t> total = 0;
+  std::atomic<uint64_t> sum = 0;
+  std::atomic<uint64_t> min_v = std::numeric_limits<uint64_t>::max();
+  std::atomic<uint64_t> max_v = 0;
+};
+
+}  // namespace dpx::trans
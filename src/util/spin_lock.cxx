@@ -1,23 +1,9 @@
 #include "util/spin_lock.hxx"
 
-#if defined(__x86_64__)
-#include <emmintrin.h>
-#endif
+#include "util/cpu_relax.hxx"
 
 namespace dpx::trans {
 
-namespace {
-
-#if defined(__x86_64__)
-inline void cpu_relax() { _mm_pause(); }
-#elif defined(__aarch64__)
-inline void cpu_relax() { asm volatile("yield" ::: "memory"); }
-#else
-inline void cpu_relax() {}
-#endif
-
-}  // namespace
-
 void SpinLock::lock() {
   while (true) {
     if (!b.exchange(true, std::memory_order_acquire)) {
@@ -2,13 +2,62 @@
 
 #include <pthread.h>
 
+#include <functional>
+#include <mutex>
+#include <queue>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "util/fatal.hxx"
 #include "util/logger.hxx"
 
 namespace dpx::trans {
 
+namespace {
+
+struct ThreadIndices {
+  std::mutex mu;
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<>> free;  // smallest first
+  size_t next = 0;
+  size_t next_hook_id = 0;
+  std::vector<std::pair<size_t, std::function<void(size_t)>>> hooks;
+};
+
+// leaked, threads may exit after static destruction
+ThreadIndices& thread_indices() {
+  static auto indices = new ThreadIndices();
+  return *indices;
+}
+
+// holds the index of its thread until the thread exits
+class ThreadIndexHolder {
+ public:
+  ThreadIndexHolder() {
+    auto& indices = thread_indices();
+    std::lock_guard l(indices.mu);
+    if (indices.free.empty()) {
+      idx = indices.next++;
+    } else {
+      idx = indices.free.top();
+      indices.free.pop();
+    }
+  }
+
+  ~ThreadIndexHolder() {
+    auto& indices = thread_indices();
+    std::lock_guard l(indices.mu);
+    for (auto& [_, hook] : indices.hooks) {
+      hook(idx);
+    }
+    indices.free.push(idx);
+  }
+
+  size_t idx = 0;
+};
+
+}  // namespace
+
 void set_thread_name(std::string name) {
   if (name.size() > 16) {
     LOG_CRITI("\"{}\" is too long. Name length is restricted to 16 characters.", name);
@@ -40,4 +89,23 @@ void bind_core(size_t core_idx) {
   }
 }
 
+size_t thread_index() {
+  thread_local ThreadIndexHolder holder;
+  return holder.idx;
+}
+
+size_t add_thread_exit_hook(std::function<void(size_t)> hook) {
+  auto& indices = thread_indices();
+  std::lock_guard l(indices.mu);
+  auto id = indices.next_hook_id++;
+  indices.hooks.emplace_back(id, std::move(hook));
+  return id;
+}
+
+void remove_thread_exit_hook(size_t id) {
+  auto& indices = thread_indices();
+  std::lock_guard l(indices.mu);
+  std::erase_if(indices.hooks, [id](const auto& h) { return h.first == id; });
+}
+
 }  // namespace dpx::trans
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 
 namespace dpx::trans {
@@ -7,5 +8,12 @@ namespace dpx::trans {
 void set_thread_name(std::string name);
 std::string get_thread_name();
 void bind_core(size_t core_idx);
+// a process-wide index of the calling thread, starting from 0. Indices are unique among live threads and are reused
+// once their threads exit, so they stay below the peak number of live threads.
+size_t thread_index();
+// `hook` runs with the index of every thread that exits holding one, on that thread, before the index is reused.
+// Returns an id for remove_thread_exit_hook, which waits for running hooks.
+size_t add_thread_exit_hook(std::function<void(size_t)> hook);
+void remove_thread_exit_hook(size_t id);
 
 }  // namespace dpx::trans
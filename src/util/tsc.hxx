@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace dpx::trans {
+
+// Raw cycle counter, cheap enough for hot paths.
+inline uint64_t rdtsc() {
+#if defined(__x86_64__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t v;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Ticks of `rdtsc` per nanosecond, calibrated against the steady clock on first use, which takes about 10ms.
+inline double tsc_per_ns() {
+  static const double ratio = []() {
+    auto t0 = std::chrono::steady_clock::now();
+    auto c0 = rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto c1 = rdtsc();
+    auto t1 = std::chrono::steady_clock::now();
+    return static_cast<double>(c1 - c0) / std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+  }();
+  return ratio;
+}
+
+}  // namespace dpx::trans
@@ -0,0 +1,106 @@
+#include "util/work_stealing_pool.hxx"
+
+#include <format>
+#include <mutex>
+
+#include "util/cpu_relax.hxx"
+#include "util/logger.hxx"
+#include "util/thread_util.hxx"
+
+namespace dpx::trans {
+
+WorkStealingPool::WorkStealingPool(size_t n_workers, std::optional<size_t> first_core) {
+  for (auto i = 0uz; i < n_workers; ++i) {
+    workers.emplace_back(std::make_unique<Worker>());
+  }
+  for (auto i = 0uz; i < n_workers; ++i) {
+    threads.emplace_back([this, i, first_core]() {
+      set_thread_name(std::format("dpx-steal-{}", i));
+      if (first_core.has_value()) {
+        bind_core(first_core.value() + i);
+      }
+      work(i);
+    });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  stopping.store(true);
+  // wake up all sleeping workers
+  published.fetch_add(1);
+  published.notify_all();
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+void WorkStealingPool::submit(Task task) {
+  auto& w = *workers[next.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+  // counted before it can be taken, so the count never drops below zero
+  n_tasks.fetch_add(1);
+  {
+    std::lock_guard l(w.lock);
+    w.tasks.emplace_back(std::move(task));
+  }
+  published.fetch_add(1);
+  published.notify_one();
+}
+
+void WorkStealingPool::work(size_t idx) {
+  Task task;
+  auto n_spins = 0uz;
+  while (true) {
+    // read before looking for tasks, any task published later changes it, so parking on it misses none
+    auto epoch = published.load();
+    if (try_pop(idx, task) || try_steal(idx, task)) {
+      n_tasks.fetch_sub(1);
+      n_spins = 0;
+      try {
+        task();
+      } catch (const std::exception& e) {
+        LOG_ERROR("Task throws an exception: {}", e.what());
+      } catch (...) {
+        LOG_ERROR("Task throws an unknown exception");
+      }
+      task = Task();
+      continue;
+    }
+    if (stopping.load()) {
+      break;
+    }
+    // counted tasks not found are being published or behind a busy lock, they show up shortly
+    if (n_tasks.load() != 0 && n_spins++ < max_spins) {
+      cpu_relax();
+      continue;
+    }
+    n_spins = 0;
+    published.wait(epoch);
+  }
+}
+
+bool WorkStealingPool::try_pop(size_t idx, Task& task) {
+  auto& w = *workers[idx];
+  std::lock_guard l(w.lock);
+  if (w.tasks.empty()) {
+    return false;
+  }
+  task = std::move(w.tasks.back());
+  w.tasks.pop_back();
+  return true;
+}
+
+bool WorkStealingPool::try_steal(size_t idx, Task& task) {
+  for (auto i = 1uz; i < workers.size(); ++i) {
+    auto& w = *workers[(idx + i) % workers.size()];
+    std::unique_lock l(w.lock, std::try_to_lock);
+    if (!l.owns_lock() || w.tasks.empty()) {
+      continue;
+    }
+    task = std::move(w.tasks.front());
+    w.tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+}  // namespace dpx::trans
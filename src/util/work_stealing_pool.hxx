@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "util/noncopyable.hxx"
+#include "util/nonmovable.hxx"
+#include "util/spin_lock.hxx"
+
+namespace dpx::trans {
+
+// A pool of worker threads with one task deque per worker.
+// A worker runs its own tasks in LIFO order and steals from the others in FIFO order when it runs out of tasks.
+class WorkStealingPool : Noncopyable, Nonmovable {
+  // rounds an idle worker retries while tasks are pending before it parks
+  constexpr static size_t max_spins = 64;
+
+ public:
+  // a move-only type-erased task
+  class Task {
+    struct Base {
+      virtual ~Base() = default;
+      virtual void run() = 0;
+    };
+
+    template <typename F>
+    struct Impl final : Base {
+      template <typename G>
+      explicit Impl(G&& g) : f(std::forward<G>(g)) {}
+      void run() override { f(); }
+      F f;
+    };
+
+   public:
+    Task() = default;
+    template <typename F>
+      requires(!std::is_same_v<std::decay_t<F>, Task>)
+    Task(F&& f) : impl(std::make_unique<Impl<std::decay_t<F>>>(std::forward<F>(f))) {}
+
+    void operator()() { impl->run(); }
+    explicit operator bool() const { return impl != nullptr; }
+
+   private:
+    std::unique_ptr<Base> impl;
+  };
+
+  // workers are pinned to [first_core, first_core + n_workers) if first_core is given
+  explicit WorkStealingPool(size_t n_workers, std::optional<size_t> first_core = std::nullopt);
+  // runs the remaining tasks, then joins all workers
+  ~WorkStealingPool();
+
+  void submit(Task task);
+
+  size_t size() const { return workers.size(); }
+
+ private:
+  struct alignas(64) Worker {
+    SpinLock lock;
+    std::deque<Task> tasks;
+  };
+
+  void work(size_t idx);
+  bool try_pop(size_t idx, Task& task);
+  bool try_steal(size_t idx, Task& task);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic_size_t next = 0;
+  std::atomic_size_t n_tasks = 0;      // submitted and not yet taken
+  std::atomic_uint32_t published = 0;  // bumped whenever a task is published, parked workers wait on it
+  std::atomic_bool stopping = false;
+};
+
+}  // namespace dpx::trans
@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.hxx"
+
+using namespace dpx::trans;
+
+TEST_CASE("Size Class") {
+  REQUIRE(BufferPool::size_class_of(0) == 0);
+  REQUIRE(BufferPool::size_class_of(64) == 0);
+  REQUIRE(BufferPool::size_class_of(65) == 1);
+  REQUIRE(BufferPool::class_size(BufferPool::size_class_of(4096)) == 4096);
+  REQUIRE(BufferPool::class_size(BufferPool::size_class_of(4097)) == 8192);
+}
+
+TEST_CASE("Buffer Pool") {
+  BufferPool pool(64 * 1024, false, 4, 16);
+
+  SECTION("Acquire and reuse") {
+    void* p = nullptr;
+    {
+      auto b = pool.acquire(100);
+      REQUIRE(b.size() == 100);
+      REQUIRE(b.capacity() == 128);
+      REQUIRE(pool.owns(b));
+      p = b.raw_data();
+    }
+    auto b = pool.acquire(128);
+    REQUIRE(b.raw_data() == p);
+  }
+
+  SECTION("Resize within capacity") {
+    auto b = pool.acquire(10);
+    b.resize(64);
+    REQUIRE(b.size() == 64);
+    REQUIRE_THROWS(b.resize(65));
+    REQUIRE_THROWS(b.sub_region(32, 64));
+  }
+
+  SECTION("Move") {
+    auto a = pool.acquire(1000);
+    auto p = a.raw_data();
+    Buffer b = std::move(a);
+    REQUIRE(a.empty());
+    REQUIRE(b.raw_data() == p);
+  }
+
+  SECTION("Exhausted") {
+    std::vector<Buffer> bs;
+    for (auto i = 0uz; i < 16; ++i) {
+      bs.emplace_back(pool.acquire(4096));
+    }
+    // past the limit buffers come from the heap
+    auto b = pool.acquire(4000);
+    REQUIRE(b.size() == 4000);
+    REQUIRE(b.capacity() == 4096);
+    REQUIRE_FALSE(pool.owns(b));
+    std::memset(b.raw_data(), 0xff, b.capacity());
+    auto n_chunks = pool.chunks().size();
+    b.release();
+    REQUIRE(pool.chunks().size() == n_chunks);
+    bs.clear();
+    auto c = pool.acquire(4096);
+    REQUIRE(pool.owns(c));
+  }
+
+  SECTION("Large buffer") {
+    auto b = pool.acquire(1024 * 1024);
+    REQUIRE(b.capacity() == 1024 * 1024);
+    REQUIRE(pool.owns(b));
+    // no more than the buffer itself is mapped
+    auto chunks = pool.chunks();
+    REQUIRE(chunks.size() == 1);
+    REQUIRE(chunks[0].size() == 1024 * 1024);
+  }
+
+  SECTION("Chunk listeners") {
+    std::vector<MemoryRegion> seen;
+    auto id = pool.add_chunk_listener([&](const MemoryRegion& chunk) { seen.push_back(chunk); });
+    auto a = pool.acquire(1024 * 1024);
+    pool.remove_chunk_listener(id);
+    auto b = pool.acquire(1024 * 1024);
+    REQUIRE(pool.chunks().size() == 2);
+    REQUIRE(seen.size() == 1);
+    REQUIRE(seen[0].contain(a));
+  }
+
+  SECTION("Release from other threads") {
+    std::vector<Buffer> bs;
+    for (auto i = 0uz; i < 16; ++i) {
+      bs.emplace_back(pool.acquire(256));
+    }
+    std::thread t([&]() {
+      bs.clear();
+      pool.flush_local_cache();
+    });
+    t.join();
+    for (auto i = 0uz; i < 16; ++i) {
+      bs.emplace_back(pool.acquire(256));
+    }
+    REQUIRE(bs.size() == 16);
+  }
+
+  SECTION("Short-lived threads") {
+    // indices and cached buffers of exited threads are recycled, otherwise the pool runs out of either
+    for (auto i = 0uz; i < 2 * BufferPool::max_threads; ++i) {
+      std::exception_ptr err;
+      std::thread([&]() {
+        try {
+          auto b = pool.acquire(256);
+        } catch (...) {
+          err = std::current_exception();
+        }
+      }).join();
+      REQUIRE(err == nullptr);
+    }
+  }
+}
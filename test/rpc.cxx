@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <array>
+#include <asio.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "provider/tcp/endpoint.hxx"
+#include "rpc_desc.hxx"
+#include "rpc_transport.hxx"
+#include "test_util.hxx"
+
+using namespace dpx::trans;
+
+struct EchoRequest {
+  uint64_t id;
+  std::string msg;
+};
+
+struct EchoResponse {
+  uint64_t id;
+  std::string msg;
+};
+
+struct CountRequest {
+  char c;
+  std::string_view text;
+};
+
+using Echo = RpcDesc<"Echo", EchoRequest, EchoResponse>;
+using Notify = RpcDesc<"Notify", uint64_t, void>;
+using Count = RpcDesc<"Count", CountRequest, uint64_t>;
+
+std::pair<tcp::Endpoint, tcp::Endpoint> loopback_pair(asio::io_context& io) {
+  asio::ip::tcp::acceptor a(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket c(io);
+  c.connect(a.local_endpoint());
+  auto s = a.accept();
+  return {tcp::Endpoint(std::move(s)), tcp::Endpoint(std::move(c))};
+}
+
+TEST_CASE("Pipelined RPC over TCP") {
+  asio::io_context io(1);
+  auto [se, ce] = loopback_pair(io);
+  RpcTransport<Backend::TCP, Side::ServerSide, Echo, Notify> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Echo, Notify> client(ce, 1024, 8);
+
+  uint64_t notified = 0;
+  server.register_handler<Echo>([](EchoRequest& req) { return EchoResponse{req.id, req.msg + "!"}; });
+  server.register_handler<Notify>([&](uint64_t& v) { notified += v; });
+
+  constexpr size_t n_callers = 32;
+  size_t n_done = 0;
+  auto caller = [&](uint64_t i) -> asio::awaitable<void> {
+    auto resp = co_await client.call<Echo>(EchoRequest{i, std::to_string(i)});
+    REQUIRE(resp.id == i);
+    REQUIRE(resp.msg == std::to_string(i) + "!");
+    co_await client.call<Notify>(i);
+    if (++n_done == n_callers) {
+      auto resp = co_await client.call<Echo>(EchoRequest{0, "bye"});
+      REQUIRE(resp.msg == "bye!");
+      ce.close();
+    }
+  };
+
+  asio::co_spawn(io, server.serve(), rethrow);
+  asio::co_spawn(io, client.run(), rethrow);
+  for (auto i = 0uz; i < n_callers; ++i) {
+    asio::co_spawn(io, caller(i), rethrow);
+  }
+  io.run();
+
+  REQUIRE(n_done == n_callers);
+  REQUIRE(notified == n_callers * (n_callers - 1) / 2);
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
+
+TEST_CASE("RPC with Integrity Check") {
+  asio::io_context io(1);
+  auto [se, ce] = loopback_pair(io);
+  RpcTransport<Backend::TCP, Side::ServerSide, Echo, Count> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Echo, Count> client(ce);
+  server.set_integrity_check(true);
+  client.set_integrity_check(true);
+
+  server.register_handler<Echo>([](EchoRequest& req) { return EchoResponse{req.id, req.msg}; });
+
+  auto caller = [&]() -> asio::awaitable<void> {
+    for (auto len : {0uz, 1uz, 4096uz, 60000uz}) {
+      auto resp = co_await client.call<Echo>(EchoRequest{len, std::string(len, 'x')});
+      REQUIRE(resp.id == len);
+      REQUIRE(resp.msg.size() == len);
+    }
+    // error responses are checked as well, Count is left with the default handler
+    std::string why;
+    try {
+      co_await client.call<Count>(CountRequest{'x', "text"});
+    } catch (const std::runtime_error& err) {
+      why = err.what();
+    }
+    REQUIRE(why.find("Default handler") != std::string::npos);
+    ce.close();
+  };
+
+  asio::co_spawn(io, server.serve(), rethrow);
+  asio::co_spawn(io, client.run(), rethrow);
+  asio::co_spawn(io, caller(), rethrow);
+  io.run();
+
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
+
+// forwards the byte stream, flipping the byte at `corrupt_at`, and closes both sockets once either side ends
+asio::awaitable<void> relay(asio::ip::tcp::socket& from, asio::ip::tcp::socket& to, size_t corrupt_at) {
+  std::array<uint8_t, 4096> buf;
+  try {
+    for (auto offset = 0uz;;) {
+      auto n = co_await from.async_read_some(asio::buffer(buf), asio::use_awaitable);
+      if (corrupt_at >= offset && corrupt_at < offset + n) {
+        buf[corrupt_at - offset] ^= 0xff;
+      }
+      offset += n;
+      co_await asio::async_write(to, asio::buffer(buf.data(), n), asio::use_awaitable);
+    }
+  } catch (const std::system_error&) {
+  }
+  asio::error_code ec;
+  from.close(ec);
+  to.close(ec);
+}
+
+TEST_CASE("RPC with Corrupted Payload") {
+  asio::io_context io(1);
+  asio::ip::tcp::acceptor a(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket c(io);
+  c.connect(a.local_endpoint());
+  auto rc = a.accept();
+  asio::ip::tcp::socket rs(io);
+  rs.connect(a.local_endpoint());
+  tcp::Endpoint ce(std::move(c));
+  tcp::Endpoint se(a.accept());
+  RpcTransport<Backend::TCP, Side::ServerSide, Echo> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Echo> client(ce);
+  client.set_integrity_check(true);
+
+  bool handled = false;
+  server.register_handler<Echo>([&](EchoRequest& req) {
+    handled = true;
+    return EchoResponse{req.id, req.msg};
+  });
+
+  std::string call_error;
+  auto caller = [&]() -> asio::awaitable<void> {
+    try {
+      co_await client.call<Echo>(EchoRequest{1, std::string(100, 'x')});
+    } catch (const std::runtime_error& err) {
+      call_error = err.what();
+    }
+  };
+
+  std::string serve_error;
+  auto on_serve_done = [&](std::exception_ptr e) {
+    try {
+      if (e) {
+        std::rethrow_exception(e);
+      }
+    } catch (const std::runtime_error& err) {
+      serve_error = err.what();
+    }
+  };
+  // a byte in the middle of the message of the first request
+  asio::co_spawn(io, relay(rc, rs, sizeof(RpcHeader) + 50), rethrow);
+  asio::co_spawn(io, relay(rs, rc, std::numeric_limits<size_t>::max()), rethrow);
+  asio::co_spawn(io, server.serve(), on_serve_done);
+  asio::co_spawn(io, client.run(), rethrow);
+  asio::co_spawn(io, caller(), rethrow);
+  io.run();
+
+  // the server drops the frame and closes the connection, which ends the client as well
+  REQUIRE_FALSE(handled);
+  REQUIRE(serve_error.find("Checksum mismatch") != std::string::npos);
+  REQUIRE(call_error.find("closed") != std::string::npos);
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
+
+TEST_CASE("RPC with Failing Handlers") {
+  asio::io_context io(1);
+  auto [se, ce] = loopback_pair(io);
+  RpcTransport<Backend::TCP, Side::ServerSide, Echo, Count> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Echo, Count> client(ce);
+
+  // Count is left with the default handler, which throws
+  server.register_handler<Echo>([](EchoRequest& req) {
+    if (req.msg.empty()) {
+      throw std::invalid_argument("empty message");
+    }
+    return EchoResponse{req.id, req.msg};
+  });
+
+  auto caller = [&]() -> asio::awaitable<void> {
+    std::string why;
+    try {
+      co_await client.call<Echo>(EchoRequest{1, ""});
+    } catch (const std::runtime_error& err) {
+      why = err.what();
+    }
+    REQUIRE(why.find("empty message") != std::string::npos);
+    why.clear();
+    try {
+      co_await client.call<Count>(CountRequest{'x', "text"});
+    } catch (const std::runtime_error& err) {
+      why = err.what();
+    }
+    REQUIRE(why.find("Default handler") != std::string::npos);
+    // the connection outlives failed requests
+    auto resp = co_await client.call<Echo>(EchoRequest{2, "ok"});
+    REQUIRE(resp.id == 2);
+    REQUIRE(resp.msg == "ok");
+    ce.close();
+  };
+
+  asio::co_spawn(io, server.serve(), rethrow);
+  asio::co_spawn(io, client.run(), rethrow);
+  asio::co_spawn(io, caller(), rethrow);
+  io.run();
+
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
+
+TEST_CASE("RPC with Views") {
+  asio::io_context io(1);
+  auto [se, ce] = loopback_pair(io);
+  RpcTransport<Backend::TCP, Side::ServerSide, Count> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Count> client(ce);
+
+  // the text is not copied out of the receive buffer
+  server.register_handler<Count>([](CountRequest& req) -> uint64_t { return std::ranges::count(req.text, req.c); });
+
+  auto caller = [&]() -> asio::awaitable<void> {
+    std::string text = "a view into the receive buffer";
+    auto n = co_await client.call<Count>(CountRequest{'e', text});
+    REQUIRE(n == 6);
+    n = co_await client.call<Count>(CountRequest{'x', ""});
+    REQUIRE(n == 0);
+    ce.close();
+  };
+
+  asio::co_spawn(io, server.serve(), rethrow);
+  asio::co_spawn(io, client.run(), rethrow);
+  asio::co_spawn(io, caller(), rethrow);
+  io.run();
+
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
@@ -0,0 +1,98 @@
+#include <asio.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "provider/tcp/endpoint.hxx"
+#include "rpc_desc.hxx"
+#include "rpc_transport.hxx"
+#include "runtime.hxx"
+
+using namespace dpx::trans;
+
+using Square = RpcDesc<"Square", uint64_t, uint64_t>;
+
+TEST_CASE("Offload") {
+  Runtime rt(1, 2);
+  rt.start();
+  std::promise<std::pair<bool, bool>> p;
+  asio::co_spawn(
+      rt.io(0),
+      [&]() -> asio::awaitable<void> {
+        auto io_thread = std::this_thread::get_id();
+        auto worker_thread = co_await rt.offload([]() { return std::this_thread::get_id(); });
+        p.set_value({worker_thread != io_thread, std::this_thread::get_id() == io_thread});
+      },
+      asio::detached);
+  auto [on_worker, back_to_io] = p.get_future().get();
+  REQUIRE(on_worker);
+  REQUIRE(back_to_io);
+}
+
+TEST_CASE("Offload Exception") {
+  Runtime rt(1, 1);
+  rt.start();
+  std::promise<bool> p;
+  asio::co_spawn(
+      rt.io(0),
+      [&]() -> asio::awaitable<void> {
+        try {
+          co_await rt.offload([]() { throw std::runtime_error("oops"); });
+          p.set_value(false);
+        } catch (const std::runtime_error&) {
+          p.set_value(true);
+        }
+      },
+      asio::detached);
+  REQUIRE(p.get_future().get());
+}
+
+TEST_CASE("Sharded RPC with Offloaded Handler") {
+  Runtime rt(2, 2);
+  asio::ip::tcp::acceptor a(rt.io(0), asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket c(rt.io(1));
+  c.connect(a.local_endpoint());
+  asio::ip::tcp::socket s(rt.io(0));
+  a.accept(s);
+  tcp::Endpoint se(std::move(s));
+  tcp::Endpoint ce(std::move(c));
+
+  RpcTransport<Backend::TCP, Side::ServerSide, Square> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Square> client(ce);
+  server.register_handler<Square>(
+      [](uint64_t& x) {
+        if (x > 100) {
+          throw std::out_of_range("too large");
+        }
+        return x * x;
+      },
+      &rt.offload_workers());
+
+  std::promise<uint64_t> p;
+  std::string why;
+  asio::co_spawn(rt.io(0), server.serve(), asio::detached);
+  asio::co_spawn(rt.io(1), client.run(), asio::detached);
+  asio::co_spawn(
+      rt.io(1),
+      [&]() -> asio::awaitable<void> {
+        uint64_t sum = 0;
+        for (auto i = 0uz; i < 100; ++i) {
+          sum += co_await client.call<Square>(i);
+        }
+        // a failing offloaded handler is answered as well, instead of leaving the call waiting
+        try {
+          co_await client.call<Square>(uint64_t{101});
+        } catch (const std::runtime_error& err) {
+          why = err.what();
+        }
+        p.set_value(sum);
+      },
+      asio::detached);
+  rt.start();
+  REQUIRE(p.get_future().get() == 328350);
+  REQUIRE(why.find("too large") != std::string::npos);
+  rt.stop();
+  rt.join();
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "serializer/zpp_bits_serializer.hxx"
+
+using namespace dpx::trans;
+
+struct Vec3 {
+  uint32_t x;
+  uint32_t y;
+  uint32_t z;
+};
+
+// 4 bytes of tail padding
+struct Point {
+  uint64_t x;
+  uint32_t y;
+};
+
+// only `a` goes on the wire
+struct Partial {
+  uint32_t a;
+  uint32_t b;
+
+  constexpr static auto serialize(auto &archive, auto &self) { return archive(self.a); }
+};
+
+struct FinalVec final {
+  uint32_t x;
+  uint32_t y;
+};
+
+// only `a` goes on the wire, and no probe can derive from it
+struct FinalPartial final {
+  uint32_t a;
+  uint32_t b;
+
+  constexpr static auto serialize(auto &archive, auto &self) { return archive(self.a); }
+};
+
+class FinalHandle final {
+ public:
+  explicit FinalHandle(uint32_t id_ = 0) : id(id_) {}
+
+ private:
+  uint32_t id;
+};
+
+struct Message {
+  uint64_t id;
+  std::string msg;
+};
+
+struct Batch {
+  Point origin;
+  std::vector<Message> messages;
+  std::array<uint16_t, 3> tags;
+};
+
+struct MessageView {
+  uint64_t id;
+  std::string_view msg;
+  std::span<const uint32_t> values;
+};
+
+using S = ZppBitsSerializer;
+using D = ZppBitsDeserializer;
+
+static_assert(is_memcpy_layout_v<Vec3> && is_memcpy_layout_v<uint64_t> && is_memcpy_layout_v<double>);
+static_assert(S::is_fixed_size<Vec3> && S::fixed_size<Vec3> == sizeof(Vec3));
+static_assert(!is_memcpy_layout_v<Point>);
+static_assert(S::is_fixed_size<Point> && S::fixed_size<Point> == sizeof(uint64_t) + sizeof(uint32_t));
+static_assert(!is_memcpy_layout_v<Partial> && !S::is_sizeable<Partial>);
+static_assert(is_memcpy_layout_v<FinalVec>);
+static_assert(!is_memcpy_layout_v<FinalPartial> && !S::is_sizeable<FinalPartial>);
+static_assert(!is_memcpy_layout_v<FinalHandle>);
+static_assert(S::is_fixed_size<uint64_t> && S::fixed_size<uint64_t> == sizeof(uint64_t));
+static_assert(!S::is_fixed_size<Message> && S::is_sizeable<Message>);
+static_assert(contains_view_v<MessageView> && !is_memcpy_layout_v<MessageView>);
+static_assert(!contains_view_v<Batch>);
+
+TEST_CASE("Serializer") {
+  std::vector<uint8_t> storage(4096);
+  MemoryRegion buffer(storage.data(), storage.size());
+
+  SECTION("Memcpy") {
+    Vec3 v{1, 2, 3};
+    auto len = S::serialize(buffer, v);
+    REQUIRE(len == sizeof(Vec3));
+    Vec3 r{};
+    REQUIRE(D::deserialize(buffer.sub_region(0, len.value()), r));
+    REQUIRE((r.x == 1 && r.y == 2 && r.z == 3));
+  }
+  SECTION("Padding") {
+    // encoded as it is when nested, without the padding
+    Point p{1, 2};
+    auto len = S::serialize(buffer, p);
+    REQUIRE(len == S::fixed_size<Point>);
+    Point r{};
+    REQUIRE(D::deserialize(buffer.sub_region(0, len.value()), r));
+    REQUIRE((r.x == 1 && r.y == 2));
+  }
+  SECTION("Exact size") {
+    Batch b{{1, 2}, {{1, "a"}, {2, std::string(100, 'b')}}, {1, 2, 3}};
+    auto len = S::serialize(buffer, b);
+    REQUIRE(len.has_value());
+    REQUIRE(S::size(b) == len.value());
+    // fits exactly, one byte less fails
+    REQUIRE(S::serialize(buffer.sub_region(0, len.value()), b) == len);
+    REQUIRE_FALSE(S::serialize(buffer.sub_region(0, len.value() - 1), b).has_value());
+    Batch r;
+    REQUIRE(D::deserialize(buffer.sub_region(0, len.value()), r));
+    REQUIRE(r.messages.size() == 2);
+    REQUIRE(r.messages[1].msg == b.messages[1].msg);
+    REQUIRE(r.tags == b.tags);
+  }
+  SECTION("Views") {
+    std::string msg = "abcd";
+    std::vector<uint32_t> values = {1, 2, 3};
+    MessageView v{7, msg, values};
+    auto len = S::serialize(buffer, v);
+    REQUIRE(len.has_value());
+    REQUIRE(S::size(v) == len.value());
+    MessageView r{};
+    auto src = buffer.sub_region(0, len.value());
+    REQUIRE(D::deserialize(src, r));
+    REQUIRE(r.id == 7);
+    REQUIRE(r.msg == msg);
+    REQUIRE(std::equal(r.values.begin(), r.values.end(), values.begin(), values.end()));
+    // no copies, both views point into the buffer
+    REQUIRE(src.contain(MemoryRegion(const_cast<char *>(r.msg.data()), r.msg.size())));
+    REQUIRE(src.contain(MemoryRegion(const_cast<uint32_t *>(r.values.data()), r.values.size_bytes())));
+  }
+  SECTION("Misaligned views") {
+    std::string msg = "abc";
+    std::vector<uint32_t> values = {1, 2, 3};
+    MessageView v{7, msg, values};
+    auto len = S::serialize(buffer, v);
+    REQUIRE(len.has_value());
+    MessageView r{};
+    // the values would start at an odd offset
+    REQUIRE_FALSE(D::deserialize(buffer.sub_region(0, len.value()), r));
+    // views of bytes are never misaligned, neither are empty ones
+    MessageView s{7, msg, {}};
+    len = S::serialize(buffer, s);
+    REQUIRE(len.has_value());
+    REQUIRE(D::deserialize(buffer.sub_region(0, len.value()), r));
+    REQUIRE(r.msg == msg);
+  }
+}
@@ -0,0 +1,283 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <asio.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "provider/shm/connector.hxx"
+#include "provider/shm/endpoint.hxx"
+#include "provider/shm/ring.hxx"
+#include "provider/shm/segment.hxx"
+#include "rpc_desc.hxx"
+#include "rpc_transport.hxx"
+#include "test_util.hxx"
+
+using namespace dpx::trans;
+using namespace std::chrono_literals;
+
+using Echo = RpcDesc<"ShmEcho", std::string, std::string>;
+
+std::pair<shm::Endpoint, shm::Endpoint> shm_pair(asio::io_context& sio, asio::io_context& cio, const std::string& name,
+                                                 size_t ring_capacity) {
+  auto accepted = std::async(std::launch::async, [&]() {
+    return shm::Connector<Side::ServerSide>(name, ring_capacity).accept(sio, 1);
+  });
+  while (true) {
+    try {
+      auto ces = shm::Connector<Side::ClientSide>(name).connect(cio, 1);
+      auto ses = accepted.get();
+      return {std::move(ses[0]), std::move(ces[0])};
+    } catch (const std::system_error&) {
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+}
+
+TEST_CASE("Shm Ring") {
+  auto segment = shm::Segment::create("/dpx-trans-test-ring", 4096);
+  shm::Segment::unlink(segment.name());
+  auto& state = segment.header().rings[0];
+  shm::Ring producer(state, segment.ring_data(Side::ClientSide));
+  shm::Ring consumer(state, segment.ring_data(Side::ClientSide));
+
+  REQUIRE(producer.writable());
+  REQUIRE(!consumer.readable());
+  std::vector<uint8_t> in(3000), out(3000);
+  for (auto round = 0uz; round < 10; ++round) {
+    for (auto i = 0uz; i < in.size(); ++i) {
+      in[i] = static_cast<uint8_t>(round + i);
+    }
+    // wraps around from the second round on
+    REQUIRE(producer.write(in.data(), in.size()) == in.size());
+    REQUIRE(producer.write(in.data(), in.size()) == 4096 - in.size());
+    REQUIRE(!producer.writable());
+    REQUIRE(consumer.read(out.data(), out.size()) == out.size());
+    REQUIRE(in == out);
+    REQUIRE(consumer.read(out.data(), out.size()) == 4096 - in.size());
+    REQUIRE(std::memcmp(in.data(), out.data(), 4096 - in.size()) == 0);
+    REQUIRE(!consumer.readable());
+  }
+}
+
+TEST_CASE("Shm Refused") {
+  REQUIRE_THROWS_AS(shm::Segment::open("/dpx-trans-test-missing"), std::system_error);
+
+  // left listening by a server side that is gone
+  const std::string stale = "/dpx-trans-test-stale";
+  auto pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    auto segment = shm::Segment::create(stale, 4096);
+    segment.header().state.store(shm::SegmentHeader::Listening);
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  REQUIRE_THROWS_AS(shm::Segment::open(stale), std::system_error);
+  shm::Segment::unlink(stale);
+
+  // a live one is not refused
+  auto live = shm::Segment::create("/dpx-trans-test-live", 4096);
+  live.header().state.store(shm::SegmentHeader::Listening);
+  REQUIRE_NOTHROW(shm::Segment::open(live.name()));
+  shm::Segment::unlink(live.name());
+}
+
+TEST_CASE("Shm Endpoint Streaming") {
+  asio::io_context sio(1);
+  asio::io_context cio(1);
+  // messages are larger than the ring, so both sides wait for each other
+  auto [se, ce] = shm_pair(sio, cio, "dpx-trans-test-stream", 4096);
+  constexpr size_t n_msgs = 64;
+  constexpr size_t msg_size = 10000;
+
+  auto server = [&]() -> asio::awaitable<void> {
+    std::vector<uint8_t> buf(msg_size);
+    MemoryRegion mr(buf.data(), buf.size());
+    for (auto i = 0uz; i < n_msgs; ++i) {
+      auto n = co_await se.post<Op::Read>(mr);
+      REQUIRE(n == msg_size);
+      REQUIRE(buf.front() == static_cast<uint8_t>(i));
+      REQUIRE(buf.back() == static_cast<uint8_t>(i));
+    }
+    // the peer closes after the last message
+    bool eof = false;
+    try {
+      co_await se.post<Op::Read>(mr);
+    } catch (const std::system_error& err) {
+      eof = err.code() == asio::error::eof;
+    }
+    REQUIRE(eof);
+  };
+  auto client = [&]() -> asio::awaitable<void> {
+    std::vector<uint8_t> buf(msg_size);
+    std::array<MemoryRegion, 2> iov{MemoryRegion(buf.data(), 1), MemoryRegion(buf.data() + 1, msg_size - 1)};
+    for (auto i = 0uz; i < n_msgs; ++i) {
+      std::memset(buf.data(), static_cast<int>(i), buf.size());
+      auto n = co_await ce.post<Op::Write>(std::span(iov));
+      REQUIRE(n == msg_size);
+    }
+    ce.close();
+  };
+
+  asio::co_spawn(sio, server(), rethrow);
+  asio::co_spawn(cio, client(), rethrow);
+  std::thread t([&]() { sio.run(); });
+  cio.run();
+  t.join();
+}
+
+TEST_CASE("Shm Endpoints Share a Waiter") {
+  asio::io_context sio(1);
+  asio::io_context cio(1);
+  constexpr size_t n_pairs = 8;
+  std::vector<shm::Endpoint> ses;
+  std::vector<shm::Endpoint> ces;
+  for (auto i = 0uz; i < n_pairs; ++i) {
+    auto [se, ce] = shm_pair(sio, cio, "dpx-trans-test-waiter-" + std::to_string(i), 4096);
+    se.set_spin_rounds(0);
+    ses.emplace_back(std::move(se));
+    ces.emplace_back(std::move(ce));
+  }
+  auto n_threads = []() {
+    return std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator());
+  };
+  auto before = n_threads();
+
+  size_t n_eof = 0;
+  auto reader = [&](shm::Endpoint& e) -> asio::awaitable<void> {
+    uint8_t b = 0;
+    MemoryRegion mr(&b, 1);
+    try {
+      co_await e.post<Op::Read>(mr);
+    } catch (const std::system_error& err) {
+      n_eof += err.code() == asio::error::eof;
+    }
+  };
+  for (auto& e : ses) {
+    asio::co_spawn(sio, reader(e), rethrow);
+  }
+  // every reader parks, one thread waits for all of them
+  sio.poll();
+  REQUIRE(n_threads() == before + 1);
+
+  for (auto& e : ces) {
+    e.close();
+  }
+  sio.run();
+  REQUIRE(n_eof == n_pairs);
+}
+
+TEST_CASE("Shm Endpoint Destroyed while Parked") {
+  asio::io_context sio(1);
+  asio::io_context cio(1);
+  auto [se, ce] = shm_pair(sio, cio, "dpx-trans-test-destroy", 4096);
+  auto e = std::make_unique<shm::Endpoint>(std::move(se));
+  e->set_spin_rounds(0);
+
+  bool aborted = false;
+  auto reader = [&](shm::Endpoint& e) -> asio::awaitable<void> {
+    uint8_t b = 0;
+    MemoryRegion mr(&b, 1);
+    try {
+      co_await e.post<Op::Read>(mr);
+    } catch (const std::system_error& err) {
+      aborted = err.code() == asio::error::operation_aborted;
+    }
+  };
+  asio::co_spawn(sio, reader(*e), rethrow);
+  sio.poll();
+  // the parked read is resumed after the endpoint is gone, and aborts
+  e.reset();
+  sio.run();
+  REQUIRE(aborted);
+}
+
+TEST_CASE("RPC over SHM") {
+  asio::io_context sio(1);
+  asio::io_context cio(1);
+  auto [se, ce] = shm_pair(sio, cio, "dpx-trans-test-rpc", shm::Connector<Side::ServerSide>::default_ring_capacity);
+  RpcTransport<Backend::SHM, Side::ServerSide, Echo> server(se, 1024 * 1024);
+  RpcTransport<Backend::SHM, Side::ClientSide, Echo> client(ce, 1024 * 1024, 8);
+
+  server.register_handler<Echo>([](std::string& req) { return req + "!"; });
+
+  constexpr size_t n_callers = 8;
+  size_t n_done = 0;
+  auto caller = [&](size_t i) -> asio::awaitable<void> {
+    for (auto len : {0uz, 1uz, 4096uz, 100000uz}) {
+      auto msg = std::string(len, static_cast<char>('a' + i));
+      auto resp = co_await client.call<Echo>(msg);
+      REQUIRE(resp == msg + "!");
+    }
+    if (++n_done == n_callers) {
+      ce.close();
+    }
+  };
+
+  asio::co_spawn(sio, server.serve(), rethrow);
+  asio::co_spawn(cio, client.run(), rethrow);
+  for (auto i = 0uz; i < n_callers; ++i) {
+    asio::co_spawn(cio, caller(i), rethrow);
+  }
+  std::thread t([&]() { sio.run(); });
+  cio.run();
+  t.join();
+
+  REQUIRE(n_done == n_callers);
+  REQUIRE(server.is_closed());
+  REQUIRE(client.is_closed());
+}
+
+TEST_CASE("SHM between Processes") {
+  const std::string name = "dpx-trans-test-fork";
+  auto pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    // the client side, exits with the number of failed calls
+    asio::io_context io(1);
+    std::vector<shm::Endpoint> ces;
+    for (auto attempt = 0; ces.empty() && attempt < 1000; ++attempt) {
+      try {
+        ces = shm::Connector<Side::ClientSide>(name).connect(io, 1);
+      } catch (const std::system_error&) {
+        std::this_thread::sleep_for(1ms);
+      }
+    }
+    if (ces.empty()) {
+      _exit(255);
+    }
+    RpcTransport<Backend::SHM, Side::ClientSide, Echo> client(ces[0]);
+    int n_failed = 0;
+    auto caller = [&]() -> asio::awaitable<void> {
+      for (auto i = 0; i < 100; ++i) {
+        auto msg = std::to_string(i);
+        n_failed += (co_await client.call<Echo>(msg)) != msg + "!";
+      }
+      ces[0].close();
+    };
+    asio::co_spawn(io, client.run(), asio::detached);
+    asio::co_spawn(io, caller(), asio::detached);
+    io.run();
+    _exit(n_failed);
+  }
+
+  asio::io_context io(1);
+  auto ses = shm::Connector<Side::ServerSide>(name).accept(io, 1);
+  RpcTransport<Backend::SHM, Side::ServerSide, Echo> server(ses[0]);
+  server.register_handler<Echo>([](std::string& req) { return req + "!"; });
+  asio::co_spawn(io, server.serve(), asio::detached);
+  io.run();
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  REQUIRE(server.is_closed());
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <asio.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "provider/tcp/endpoint.hxx"
+#include "rpc_desc.hxx"
+#include "rpc_transport.hxx"
+#include "stats.hxx"
+#include "test_util.hxx"
+
+using namespace dpx::trans;
+
+using Add = RpcDesc<"Add", uint64_t, uint64_t>;
+
+const OpStatsSnapshot* find(const std::vector<OpStatsSnapshot>& ss, const std::string& name) {
+  auto it = std::ranges::find_if(ss, [&](const auto& s) { return s.name == name; });
+  return it == ss.end() ? nullptr : &*it;
+}
+
+TEST_CASE("Op Probe") {
+  OpStats s(OpStats::Kind::Endpoint, "probe");
+  for (auto i = 0uz; i < 2 * latency_sample_rate; ++i) {
+    OpProbe p(s);
+    REQUIRE(s.inflight.get() == 1);
+    p.done(10);
+  }
+  {
+    OpProbe p(s);
+  }
+  {
+    OpProbe p(s);
+    p.cancel();
+  }
+  REQUIRE(s.inflight.get() == 0);
+  REQUIRE(s.n_ops.get() == 2 * latency_sample_rate);
+  REQUIRE(s.n_bytes.get() == 20 * latency_sample_rate);
+  REQUIRE(s.n_errors.get() == 1);
+  REQUIRE(s.latency->snapshot().count() == 2);
+
+  auto snapshot = StatsRegistry::instance().snapshot();
+  auto ss = find(snapshot.endpoints, "probe");
+  REQUIRE(ss != nullptr);
+  REQUIRE(ss->n_ops == s.n_ops.get());
+  REQUIRE(find(snapshot.rpcs, "probe") == nullptr);
+  REQUIRE(StatsRegistry::instance().dump_json().find("\"probe\"") != std::string::npos);
+
+  OpStats untimed(OpStats::Kind::Endpoint, "untimed", 0, false);
+  for (auto i = 0uz; i < 2 * latency_sample_rate; ++i) {
+    OpProbe p(untimed);
+    p.done(10);
+  }
+  REQUIRE(untimed.n_ops.get() == 2 * latency_sample_rate);
+  REQUIRE(untimed.latency == nullptr);
+}
+
+TEST_CASE("Endpoint and RPC Stats") {
+  asio::io_context io(1);
+  asio::ip::tcp::acceptor a(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket c(io);
+  c.connect(a.local_endpoint());
+  tcp::Endpoint se(a.accept());
+  tcp::Endpoint ce(std::move(c));
+  RpcTransport<Backend::TCP, Side::ServerSide, Add> server(se);
+  RpcTransport<Backend::TCP, Side::ClientSide, Add> client(ce);
+  server.register_handler<Add>([](uint64_t& x) { return x + 1; });
+
+  constexpr size_t n_calls = 10;
+  auto caller = [&]() -> asio::awaitable<void> {
+    for (auto i = 0uz; i < n_calls; ++i) {
+      auto r = co_await client.call<Add>(i);
+      REQUIRE(r == i + 1);
+    }
+    ce.close();
+  };
+  asio::co_spawn(io, server.serve(), rethrow);
+  asio::co_spawn(io, client.run(), rethrow);
+  asio::co_spawn(io, caller(), rethrow);
+  io.run();
+
+  auto snapshot = StatsRegistry::instance().snapshot();
+  auto client_add = find(snapshot.rpcs, ce.name() + " Add");
+  auto server_add = find(snapshot.rpcs, se.name() + " Add");
+  REQUIRE(client_add != nullptr);
+  REQUIRE(server_add != nullptr);
+  REQUIRE(client_add->n_ops == n_calls);
+  REQUIRE(client_add->n_bytes == 2 * n_calls * sizeof(uint64_t));
+  REQUIRE(client_add->inflight == 0);
+  REQUIRE(server_add->n_ops == n_calls);
+  REQUIRE(server_add->n_errors == 0);
+  REQUIRE(client_add->latency.n_samples >= 1);
+
+  // every call writes a request frame, possibly coalesced with others, and reads a response frame in two reads
+  constexpr size_t frame_size = sizeof(RpcHeader) + sizeof(uint64_t);
+  auto client_writes = find(snapshot.endpoints, ce.name() + " write");
+  auto client_reads = find(snapshot.endpoints, ce.name() + " read");
+  REQUIRE(client_writes != nullptr);
+  REQUIRE(client_reads != nullptr);
+  REQUIRE(client_writes->n_ops >= 1);
+  REQUIRE(client_writes->n_ops <= n_calls);
+  REQUIRE(client_writes->n_bytes == n_calls * frame_size);
+  REQUIRE(client_writes->latency.n_samples >= 1);
+  REQUIRE(client_reads->n_ops == 2 * n_calls);
+  REQUIRE(client_reads->n_bytes == n_calls * frame_size);
+  REQUIRE(client_reads->latency.n_samples == 0);
+  // closing the client aborts its last read and ends the server with eof, neither is an error
+  REQUIRE(client_reads->n_errors == 0);
+  auto server_reads = find(snapshot.endpoints, se.name() + " read");
+  REQUIRE(server_reads != nullptr);
+  REQUIRE(server_reads->n_errors == 0);
+}
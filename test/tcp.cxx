@@ -1,17 +1,23 @@
+#include <array>
 #include <asio.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <cstring>
 #include <iostream>
+#include <system_error>
 #include <thread>
+#include <vector>
 
+#include "buffer_pool.hxx"
 #include "provider/tcp/connector.hxx"
 #include "provider/tcp/endpoint.hxx"
+#include "test_util.hxx"
 
 using namespace dpx::trans;
 using namespace dpx::trans::tcp;
 using namespace std::chrono_literals;
 
 void server() {
-  Connector<Side::ServerSide> c("192.168.200.21", 10087);
+  Connector<Side::ServerSide> c("127.0.0.1", 10087);
   asio::io_context io(1);
   auto es = c.accept(io, 1);
   auto test = [&]() -> asio::awaitable<void> {
@@ -24,15 +30,24 @@ void server() {
     co_return;
   };
   asio::co_spawn(io, test(), asio::detached);
-  asio::signal_set signals(io, SIGINT, SIGTERM);
-  signals.async_wait([&](auto, auto) { io.stop(); });
   io.run();
 }
 
 void client() {
-  Connector<Side::ClientSide> c("192.168.200.21", 10087, "192.168.201.21", 10086);
+  Connector<Side::ClientSide> c("127.0.0.1", 10087, "127.0.0.1", 0);
   asio::io_context io(1);
-  auto es = c.connect(io, 1);
+  // the server may not be listening yet
+  std::vector<Endpoint> es;
+  for (auto attempt = 0; es.empty(); ++attempt) {
+    try {
+      es = c.connect(io, 1);
+    } catch (const std::system_error&) {
+      if (attempt == 100) {
+        throw;
+      }
+      std::this_thread::sleep_for(10ms);
+    }
+  }
   auto test = [&]() -> asio::awaitable<void> {
     char msg[128] = "world";
     MemoryRegion mr(msg, strlen(msg));
@@ -42,15 +57,127 @@ void client() {
     co_return;
   };
   asio::co_spawn(io, test(), asio::detached);
-  asio::signal_set signals(io, SIGINT, SIGTERM);
-  signals.async_wait([&](auto, auto) { io.stop(); });
   io.run();
 }
 
 TEST_CASE("TCP Connection Holder") {
   std::thread s(server);
-  std::this_thread::sleep_for(2s);
   std::thread c(client);
   s.join();
   c.join();
-}
\ No newline at end of file
+}
+
+TEST_CASE("TCP Scatter Gather") {
+  asio::io_context io(1);
+  asio::ip::tcp::acceptor a(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket s(io);
+  s.connect(a.local_endpoint());
+  Endpoint active(std::move(s));
+  Endpoint passive(a.accept());
+
+  auto test = [&]() -> asio::awaitable<void> {
+    uint64_t header = 0xdeadbeef;
+    char body[] = "hello world";
+    std::array<MemoryRegion, 2> out = {MemoryRegion(&header, sizeof(header)), MemoryRegion(body, sizeof(body))};
+    auto n = co_await active.post<Op::Write>(out);
+    REQUIRE(n == sizeof(header) + sizeof(body));
+
+    uint64_t r_header = 0;
+    char r_body[sizeof(body)] = {};
+    std::array<MemoryRegion, 2> in = {MemoryRegion(&r_header, sizeof(r_header)), MemoryRegion(r_body, sizeof(r_body))};
+    n = co_await passive.post<Op::Read>(in);
+    REQUIRE(n == sizeof(header) + sizeof(body));
+    REQUIRE(r_header == header);
+    REQUIRE(std::string_view(r_body) == "hello world");
+  };
+  asio::co_spawn(io, test(), rethrow);
+  io.run();
+}
+
+TEST_CASE("TCP Batched Post") {
+  constexpr size_t n_conns = 8;
+  constexpr size_t n_msgs = 100;
+  constexpr size_t msg_size = 64;
+
+  asio::io_context io(1);
+  asio::ip::tcp::acceptor a(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  std::vector<Endpoint> actives;
+  std::vector<Endpoint> passives;
+  // the pool outlives the batcher
+  BufferPool pool;
+  UringBatcher batcher(io);
+  for (auto i = 0uz; i < n_conns; ++i) {
+    asio::ip::tcp::socket s(io);
+    s.connect(a.local_endpoint());
+    auto p = a.accept();
+    // as asio leaves them once they have run an async operation
+    s.non_blocking(true);
+    p.non_blocking(true);
+    actives.emplace_back(std::move(s)).set_batcher(&batcher);
+    passives.emplace_back(std::move(p)).set_batcher(&batcher);
+  }
+
+  // chunks mapped after the registration are registered as well, before the first post runs
+  batcher.register_pool(pool);
+  std::vector<Buffer> buffers;
+  for (auto i = 0uz; i < 2 * n_conns; ++i) {
+    buffers.emplace_back(pool.acquire(msg_size));
+  }
+
+  size_t n_done = 0;
+  auto writer = [&](size_t i) -> asio::awaitable<void> {
+    auto& b = buffers[i];
+    for (auto j = 0uz; j < n_msgs; ++j) {
+      std::memset(b.data(), static_cast<int>(j), b.size());
+      auto n = co_await actives[i].post<Op::Write>(b);
+      REQUIRE(n == msg_size);
+    }
+  };
+  auto reader = [&](size_t i) -> asio::awaitable<void> {
+    auto& b = buffers[n_conns + i];
+    for (auto j = 0uz; j < n_msgs; ++j) {
+      auto n = co_await passives[i].post<Op::Read>(b);
+      REQUIRE(n == msg_size);
+      REQUIRE(b[msg_size - 1] == static_cast<uint8_t>(j));
+    }
+    if (++n_done == n_conns) {
+      batcher.stop();
+    }
+  };
+  asio::co_spawn(io, batcher.run(), rethrow);
+  // readers go first and find their sockets empty
+  for (auto i = 0uz; i < n_conns; ++i) {
+    asio::co_spawn(io, reader(i), rethrow);
+  }
+  for (auto i = 0uz; i < n_conns; ++i) {
+    asio::co_spawn(io, writer(i), rethrow);
+  }
+  io.run();
+
+  REQUIRE(n_done == n_conns);
+  REQUIRE(batcher.stats().n_sqes >= 2 * n_conns * n_msgs);
+  REQUIRE(batcher.stats().n_submits < batcher.stats().n_sqes);
+  // a socket that is not ready is polled once before the retry, instead of being retried over and over
+  REQUIRE(batcher.stats().n_sqes <= 2 * n_conns * n_msgs + 2 * batcher.stats().n_polls);
+  // every read lands in a pooled buffer
+  if (batcher.has_fixed_buffers()) {
+    REQUIRE(batcher.stats().n_fixed >= n_conns * n_msgs);
+  } else {
+    WARN("Fixed buffers are not supported, reads went without them");
+    REQUIRE(batcher.stats().n_fixed == 0);
+  }
+}
+
+TEST_CASE("TCP Batcher Destroyed with Queued Work") {
+  asio::io_context io(1);
+  BufferPool pool;
+  std::vector<Buffer> buffers;
+  {
+    UringBatcher batcher(io);
+    batcher.register_pool(pool);
+    // maps a chunk, whose registration is queued on the io_context
+    buffers.emplace_back(pool.acquire(4096));
+  }
+  // the registration finds the batcher gone
+  REQUIRE(io.run() == 1);
+}
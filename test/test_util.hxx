@@ -0,0 +1,14 @@
+#pragma once
+
+#include <exception>
+
+namespace dpx::trans {
+
+// completion handler of asio::co_spawn, lets the exception of a failed coroutine escape io_context::run
+inline constexpr auto rethrow = [](std::exception_ptr e) {
+  if (e) {
+    std::rethrow_exception(e);
+  }
+};
+
+}  // namespace dpx::trans
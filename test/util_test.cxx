@@ -1,9 +1,20 @@
+#include <array>
 #include <catch2/catch_test_macros.hpp>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
 
+#include "util/crc.hxx"
+#include "util/crc32c.hxx"
 #include "util/hex_dump.hxx"
+#include "util/histogram.hxx"
 
+using dpx::trans::Crc32cEngine;
 using dpx::trans::Hexdump;
+using dpx::trans::Histogram;
+using dpx::trans::MemoryRegion;
 
 TEST_CASE("Hexdump") {
   SECTION("Nullptr") {
@@ -27,3 +38,89 @@ TEST_CASE("Hexdump") {
     std::cout << Hexdump(p, strlen(p)) << std::endl;
   }
 }
+
+TEST_CASE("CRC32C") {
+  constexpr std::array engines = {Crc32cEngine::Table, Crc32cEngine::SliceBy8, Crc32cEngine::SSE42};
+  SECTION("Check value") {
+    const char *p = "123456789";
+    static_assert(crc::CRC32C()(std::string_view("123456789"), ~0u, ~0u) == 0xE3069283);
+    for (auto engine : engines) {
+      if (dpx::trans::crc32c_engine_supported(engine)) {
+        REQUIRE(dpx::trans::crc32c(engine, p, strlen(p)) == 0xE3069283);
+      }
+    }
+  }
+  SECTION("Match compile-time engine") {
+    std::vector<uint8_t> data(64 * 1024);
+    std::mt19937 gen(42);
+    for (auto &b : data) {
+      b = gen();
+    }
+    // unaligned heads, three-way blocks and tails
+    for (auto len : {0uz, 1uz, 7uz, 8uz, 255uz, 768uz, 1000uz, 24576uz, 24577uz, 60000uz}) {
+      for (auto offset = 0uz; offset < 8; ++offset) {
+        auto expected = crc::CRC32C()(data.data() + offset, len, ~0u, ~0u);
+        for (auto engine : engines) {
+          if (dpx::trans::crc32c_engine_supported(engine)) {
+            REQUIRE(dpx::trans::crc32c(engine, data.data() + offset, len) == expected);
+          }
+        }
+      }
+    }
+  }
+  SECTION("Memory regions") {
+    std::vector<uint8_t> data(10000);
+    std::mt19937 gen(7);
+    for (auto &b : data) {
+      b = gen();
+    }
+    std::array<MemoryRegion, 3> mrs = {MemoryRegion(data.data(), 1), MemoryRegion(data.data() + 1, 4095),
+                                       MemoryRegion(data.data() + 4096, data.size() - 4096)};
+    REQUIRE(dpx::trans::crc32c(std::span<const MemoryRegion>(mrs)) ==
+            dpx::trans::crc32c(MemoryRegion(data.data(), data.size())));
+  }
+}
+
+TEST_CASE("Histogram") {
+  auto h = std::make_unique<Histogram>();
+  SECTION("Empty") {
+    REQUIRE(h->count() == 0);
+    REQUIRE(h->percentile(99) == 0);
+  }
+  SECTION("Buckets") {
+    for (auto v : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, ~0ull}) {
+      auto idx = Histogram::index_of(v);
+      REQUIRE(idx < Histogram::n_buckets);
+      REQUIRE(Histogram::upper_bound_of(idx) >= v);
+      if (idx > 0) {
+        REQUIRE(Histogram::upper_bound_of(idx - 1) < v);
+      }
+    }
+  }
+  SECTION("Percentiles") {
+    for (auto v = 1uz; v <= 100000; ++v) {
+      h->record(v);
+    }
+    REQUIRE(h->count() == 100000);
+    REQUIRE(h->min() == 1);
+    REQUIRE(h->max() == 100000);
+    // within the relative precision of a bucket
+    auto near = [](uint64_t got, double expected) {
+      return std::abs(static_cast<double>(got) - expected) <= expected / Histogram::sub_buckets;
+    };
+    REQUIRE(near(h->percentile(50), 50000));
+    REQUIRE(near(h->percentile(99), 99000));
+    REQUIRE(near(h->percentile(99.9), 99900));
+    REQUIRE(h->percentile(100) == 100000);
+  }
+  SECTION("Merge") {
+    auto other = std::make_unique<Histogram>();
+    h->record(10);
+    other->record(1000, 3);
+    h->merge(*other);
+    REQUIRE(h->count() == 4);
+    REQUIRE(h->min() == 10);
+    REQUIRE(h->max() == 1000);
+    REQUIRE(h->percentile(25) == 10);
+  }
+}